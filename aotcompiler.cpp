@@ -0,0 +1,186 @@
+// chip8-aot: compile a ROM ahead of time into a C++ translation unit.
+//
+// usage: chip8-aot <rom> <output.cpp>
+//
+// code reachable from 0x200 through jumps, calls and skips is split into
+// blocks, the same blocks TranslateBlock builds at runtime, and every block
+// becomes a function calling the Chip8Interpreter instruction methods. the
+// output registers itself with the AOT runtime when linked into a program;
+// computed jumps (Bnnn) and code the analysis missed run interpreted.
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "decoder.h"
+
+struct Block {
+    uint16_t start;
+    uint16_t end;
+    std::vector<Instruction> code;
+};
+
+static std::array<uint8_t, 0x1000> RAM{};
+
+static Block Translate(uint16_t address) {
+    Block block{};
+    block.start = address;
+    uint16_t pc = address;
+    while (pc + 1u < RAM.size()) {
+        Instruction ins = ParseInstruction(RAM[pc] << 8 | RAM[pc + 1]);
+        block.code.push_back(ins);
+        pc += 2;
+        if (IsBlockTerminator(Decode(ins.opcode))) {
+            break;
+        }
+    }
+    block.end = pc;
+    return block;
+}
+
+// addresses control may reach after the last instruction of block.
+static std::vector<uint16_t> Successors(const Block &block) {
+    if (block.code.empty()) {
+        return {};
+    }
+    const Instruction &ins = block.code.back();
+    uint16_t pc = block.end - 2;
+    switch (Decode(ins.opcode)) {
+        case Op::JP_Addr:
+            return {ins.NNN};
+        case Op::CALL_Addr:
+            // RET continues after the call.
+            return {ins.NNN, (uint16_t) (pc + 2)};
+        case Op::SE_Vx_Byte:
+        case Op::SNE_Vx_Byte:
+        case Op::SE_Vx_Vy:
+        case Op::SNE_Vx_Vy:
+        case Op::SKP_Vx:
+        case Op::SKNP_Vx:
+            return {(uint16_t) (pc + 2), (uint16_t) (pc + 4)};
+        case Op::LD_Vx_K:
+        case Op::LD_B_Vx:
+        case Op::LD_I_Vx:
+            return {(uint16_t) (pc + 2)};
+        case Op::RET:
+        case Op::JP_V0_Addr:
+        case Op::UNKNOWN:
+            return {};
+        default:
+            // ran into the end of RAM.
+            return {};
+    }
+}
+
+static std::string Hex(unsigned value, int width) {
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%0*X", width, value);
+    return buffer;
+}
+
+// the contents of a string literal spelling text: quotes, backslashes and
+// control characters escaped, octal so that no following digit joins in.
+static std::string Escape(const std::string &text) {
+    std::string escaped;
+    for (unsigned char c: text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += (char) c;
+        } else if (c < 0x20 || c == 0x7F) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\%03o", c);
+            escaped += buffer;
+        } else {
+            escaped += (char) c;
+        }
+    }
+    return escaped;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        std::cout << "usage: chip8-aot <rom> <output.cpp>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream stream(argv[1], std::ios::binary | std::ios::in);
+    if (!stream.is_open()) {
+        std::cout << "fail to load rom: " << argv[1] << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> rom;
+    char c;
+    while (rom.size() < RAM.size() - 0x200 && stream.get(c)) {
+        rom.push_back(c);
+    }
+    if (rom.empty()) {
+        std::cout << "empty rom: " << argv[1] << std::endl;
+        return 1;
+    }
+    std::copy(rom.begin(), rom.end(), RAM.begin() + 0x200);
+
+    // reachable blocks, by start address.
+    std::map<uint16_t, Block> blocks;
+    std::vector<uint16_t> pending{0x200};
+    while (!pending.empty()) {
+        uint16_t address = pending.back();
+        pending.pop_back();
+        if (address + 1u >= RAM.size() || blocks.count(address)) {
+            continue;
+        }
+        Block block = Translate(address);
+        for (uint16_t next: Successors(block)) {
+            pending.push_back(next);
+        }
+        blocks.emplace(address, std::move(block));
+    }
+
+    std::ofstream out(argv[2], std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cout << "fail to open output: " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::string name = argv[1];
+    name = Escape(name.substr(name.find_last_of("/\\") + 1));
+
+    out << "// generated by chip8-aot from " << name << ", do not edit.\n\n";
+    out << "#include \"chip8interpreter.h\"\n";
+    out << "#include \"aotprogram.h\"\n\n";
+    out << "namespace {\n\n";
+
+    out << "const uint8_t rom[] = {";
+    for (size_t i = 0; i < rom.size(); i++) {
+        out << (i % 16 == 0 ? "\n        " : " ") << "0x" << Hex(rom[i], 2) << ",";
+    }
+    out << "\n};\n\n";
+
+    for (const auto &[address, block]: blocks) {
+        out << "uint32_t Block_" << Hex(address, 4) << "(Chip8Interpreter &c) {\n";
+        for (const Instruction &ins: block.code) {
+            out << "    c." << OpName(Decode(ins.opcode)) << "({0x" << Hex(ins.opcode, 4)
+                << ", 0x" << Hex(ins.NNN, 3) << ", 0x" << Hex(ins.KK, 2)
+                << ", 0x" << Hex(ins.X, 1) << ", 0x" << Hex(ins.Y, 1) << ", 0x" << Hex(ins.N, 1) << "});\n";
+        }
+        out << "    return " << block.code.size() << ";\n";
+        out << "}\n\n";
+    }
+
+    out << "const AotBlock blocks[] = {\n";
+    for (const auto &[address, block]: blocks) {
+        out << "        {0x" << Hex(block.start, 3) << ", 0x" << Hex(block.end, 3)
+            << ", Block_" << Hex(address, 4) << "},\n";
+    }
+    out << "};\n\n";
+
+    out << "const AotProgram program{\"" << name << "\", rom, sizeof(rom), blocks, sizeof(blocks) / sizeof(blocks[0])};\n\n";
+    out << "const AotRegistrar registrar(program);\n\n";
+    out << "}\n";
+
+    std::cout << name << ": " << blocks.size() << " blocks" << std::endl;
+    return 0;
+}
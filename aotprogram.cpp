@@ -0,0 +1,23 @@
+#include "aotprogram.h"
+
+#include <cstring>
+#include <vector>
+
+// function local, generated files register during static initialization.
+static std::vector<const AotProgram *> &Programs() {
+    static std::vector<const AotProgram *> programs;
+    return programs;
+}
+
+void RegisterAotProgram(const AotProgram &program) {
+    Programs().push_back(&program);
+}
+
+const AotProgram *FindAotProgram(const uint8_t *rom, size_t size) {
+    for (const AotProgram *program: Programs()) {
+        if (program->romSize == size && std::memcmp(program->rom, rom, size) == 0) {
+            return program;
+        }
+    }
+    return nullptr;
+}
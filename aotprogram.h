@@ -0,0 +1,39 @@
+#ifndef AOTPROGRAM_H
+#define AOTPROGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+
+class Chip8Interpreter;
+
+// a block of a ROM compiled ahead of time by chip8-aot.
+struct AotBlock {
+    // covers RAM[start, end)
+    uint16_t start;
+    uint16_t end;
+    // run the block with PC at start, return the number of instructions executed.
+    uint32_t (*function)(Chip8Interpreter &c);
+};
+
+// a ROM compiled ahead of time, matched against the bytes given to Load.
+struct AotProgram {
+    const char *name;
+    const uint8_t *rom;
+    size_t romSize;
+    const AotBlock *blocks;
+    size_t blockCount;
+};
+
+void RegisterAotProgram(const AotProgram &program);
+
+// the program compiled from exactly these ROM bytes, nullptr when there is none.
+const AotProgram *FindAotProgram(const uint8_t *rom, size_t size);
+
+// registers a program from the static initialization of a generated file.
+struct AotRegistrar {
+    explicit AotRegistrar(const AotProgram &program) {
+        RegisterAotProgram(program);
+    }
+};
+
+#endif // AOTPROGRAM_H
@@ -1,82 +1,172 @@
 #include "app.h"
 
-#include <QPixmap>
 #include <QKeyEvent>
 #include <QPainter>
 #include "windows.h"
 
 #include <iostream>
+#include <algorithm>
 
 
-App::App(QWidget *parent) : QWidget{parent} {
-    setFixedSize(canvasWidth, canvasHeight);
+App::App(const EmulatorOptions &options, QWidget *parent) : QWidget{parent} {
+    resize(canvasWidth, canvasHeight);
+    setMinimumSize(Chip8Interpreter::screenWidth, Chip8Interpreter::screenHeight);
 
-    pixmap = QPixmap(canvasWidth, canvasHeight);
-    pixmap.fill(Qt::white);
+    image = QImage(Chip8Interpreter::screenWidth, Chip8Interpreter::screenHeight, QImage::Format_Mono);
+    image.setColor(0, qRgb(255, 255, 255));
+    image.setColor(1, qRgb(0, 0, 0));
+    image.fill(0);
 
-    inter = new Chip8Interpreter();
-    connect(this, &App::KeyDown, inter, &Chip8Interpreter::KeyDown);
-    connect(this, &App::KeyUp, inter, &Chip8Interpreter::KeyUp);
-    connect(inter, &Chip8Interpreter::draw, this, &App::draw);
-    connect(inter, &Chip8Interpreter::beep, this, &App::beep);
+    keyTable.fill(-1);
+    keyTable[Qt::Key_1] = 0x1;
+    keyTable[Qt::Key_2] = 0x2;
+    keyTable[Qt::Key_3] = 0x3;
+    keyTable[Qt::Key_4] = 0xC;
+    keyTable[Qt::Key_Q] = 0x4;
+    keyTable[Qt::Key_W] = 0x5;
+    keyTable[Qt::Key_E] = 0x6;
+    keyTable[Qt::Key_R] = 0xD;
+    keyTable[Qt::Key_A] = 0x7;
+    keyTable[Qt::Key_S] = 0x8;
+    keyTable[Qt::Key_D] = 0x9;
+    keyTable[Qt::Key_F] = 0xE;
+    keyTable[Qt::Key_Z] = 0xA;
+    keyTable[Qt::Key_X] = 0x0;
+    keyTable[Qt::Key_C] = 0xB;
+    keyTable[Qt::Key_V] = 0xF;
+
+    tracing = options.trace;
+    emulator = new Emulator(options, frames, keypad);
+    emulator->moveToThread(&thread);
+    connect(&thread, &QThread::started, emulator, &Emulator::Start);
+    connect(&thread, &QThread::finished, emulator, &QObject::deleteLater);
+    connect(this, &App::Turbo, emulator, &Emulator::SetTurbo);
+    connect(this, &App::Rewind, emulator, &Emulator::SetRewind);
+    connect(this, &App::QuickSave, emulator, &Emulator::QuickSave);
+    connect(this, &App::QuickLoad, emulator, &Emulator::QuickLoad);
+    connect(this, &App::SaveProfile, emulator, &Emulator::SaveProfile);
+    connect(this, &App::Trace, emulator, &Emulator::SetTrace);
+    connect(this, &App::SaveTrace, emulator, &Emulator::SaveTrace);
+    connect(emulator, &Emulator::frameReady, this, &App::frameReady);
+    connect(emulator, &Emulator::beep, this, &App::beep);
+    connect(emulator, &Emulator::stats, this, &App::stats);
 
     std::cout << "loading rom." << std::endl;
-    // inter->Load("..\\rom\\IBM Logo.ch8");
-    bool res = inter->Load("..\\rom\\Breakout (Brix hack) [David Winter, 1997].ch8");
+    // emulator->core.Load("..\\rom\\IBM Logo.ch8");
+    bool res = emulator->core.Load("..\\rom\\Breakout (Brix hack) [David Winter, 1997].ch8");
     if (res) {
         std::cout << "rom loaded." << std::endl;
-        inter->start();
+        thread.start();
     } else {
         std::cout << "fail to load rom." << std::endl;
     }
 }
 
 void App::closeEvent(QCloseEvent *event) {
-    inter->exit();
+    thread.quit();
+    thread.wait();
+    std::cout << latency.Report();
 }
 
 void App::keyPressEvent(QKeyEvent *event) {
     auto k = event->key();
-    if (keyMap.find(k) != keyMap.end()) {
-        emit KeyDown(keyMap[k]);
-        std::cout << "key pressed: " << k << std::endl;
+    if (k == turboKey && !event->isAutoRepeat()) {
+        emit Turbo(true);
+    }
+    if (k == rewindKey && !event->isAutoRepeat()) {
+        emit Rewind(true);
+    }
+    if (k == quickSaveKey) {
+        emit QuickSave();
+    }
+    if (k == quickLoadKey) {
+        emit QuickLoad();
+    }
+    if (k == saveProfileKey) {
+        emit SaveProfile();
+    }
+    if (k == traceKey && !event->isAutoRepeat()) {
+        tracing = !tracing;
+        emit Trace(tracing);
+    }
+    if (k == saveTraceKey) {
+        emit SaveTrace();
+    }
+    if (k >= 0 && k < (int) keyTable.size() && keyTable[k] >= 0) {
+        keypad.Press(keyTable[k]);
     }
 }
 
 void App::keyReleaseEvent(QKeyEvent *event) {
     auto k = event->key();
-    if (keyMap.find(k) != keyMap.end()) {
-        emit KeyUp(keyMap[k]);
-        // std::cout << "key released: " << k << std::endl;
+    if (k == turboKey && !event->isAutoRepeat()) {
+        emit Turbo(false);
+    }
+    if (k == rewindKey && !event->isAutoRepeat()) {
+        emit Rewind(false);
+    }
+    if (k >= 0 && k < (int) keyTable.size() && keyTable[k] >= 0) {
+        keypad.Release(keyTable[k]);
     }
 }
 
 void App::paintEvent(QPaintEvent *event) {
+    bool consumed = frames.Consume();
+    if (consumed) {
+        draw(frames.Front());
+    }
+
+    // largest 2:1 area of the window.
+    int scale = std::max(1, std::min(width() / Chip8Interpreter::screenWidth, height() / Chip8Interpreter::screenHeight));
+    QRect target(0, 0, Chip8Interpreter::screenWidth * scale, Chip8Interpreter::screenHeight * scale);
+    target.moveCenter(rect().center());
+
     QPainter painter(this);
-    painter.drawPixmap(0, 0, pixmap);
-}
+    painter.fillRect(rect(), Qt::white);
+    painter.drawImage(target, image);
 
-void App::draw(std::array<std::array<bool, Chip8Interpreter::screenWidth>, Chip8Interpreter::screenHeight> buffer) {
-    int height = Chip8Interpreter::screenHeight;
-    int width = Chip8Interpreter::screenWidth;
-
-    QPainter painter(&pixmap);
-    Qt::GlobalColor color = Qt::white;
-    for (int x = 0; x < height; x++) {
-        for (int y = 0; y < width; y++) {
-            if (buffer[x][y]) {
-                color = Qt::black;
-            } else {
-                color = Qt::white;
-            }
-            QRect rect((y * 10) % canvasWidth, (x * 10) % canvasHeight, 10, 10);
-            painter.fillRect(rect, color);
-        }
+    const Frame &frame = frames.Front();
+    if (consumed && frame.pressedAt != 0 && frame.pressedAt != probedAt) {
+        latency.Add(frame.pressedAt, frame.observedAt, frame.publishedAt, Keypad::Now());
+        probedAt = frame.pressedAt;
     }
+}
 
+void App::frameReady() {
     update();
 }
 
+void App::draw(const Frame &frame) {
+    // Format_Mono is most significant bit first, like the rows of Screen.
+    for (int row = 0; row < Chip8Interpreter::screenHeight; row++) {
+        if (!(frame.dirtyRows & 1u << row)) {
+            continue;
+        }
+        uchar *line = image.scanLine(row);
+        uint64_t pixels = frame.buffer[row];
+        for (int i = 0; i < 8; i++) {
+            line[i] = pixels >> (56 - 8 * i);
+        }
+    }
+}
+
 void App::beep(int milliseconds) {
     Beep(500, milliseconds);
 }
+
+void App::stats(double framesPerSecond, double instructionsPerSecond, double idleFraction,
+                double rewindSeconds, qulonglong rewindUsed, qulonglong rewindBudget) {
+    setWindowTitle(QString("chip8 - %1 fps, %2 ips, %3% idle, frames %4 produced, %5 presented, %6 dropped, "
+                           "key to screen p50 %7 p99 %8 ms, rewind %9 s in %10/%11 KB")
+                           .arg(framesPerSecond, 0, 'f', 1)
+                           .arg(instructionsPerSecond, 0, 'f', 0)
+                           .arg(idleFraction * 100, 0, 'f', 1)
+                           .arg(frames.Produced())
+                           .arg(frames.Presented())
+                           .arg(frames.Dropped())
+                           .arg(latency.total.Percentile(0.5), 0, 'f', 1)
+                           .arg(latency.total.Percentile(0.99), 0, 'f', 1)
+                           .arg(rewindSeconds, 0, 'f', 1)
+                           .arg(rewindUsed / 1024)
+                           .arg(rewindBudget / 1024));
+}
@@ -1,13 +1,16 @@
 #ifndef APP_H
 #define APP_H
 
-#include <map>
+#include <array>
 #include <Qt>
 #include <QWidget>
 #include <QLabel>
 #include <QVBoxLayout>
 #include <QCloseEvent>
-#include "Chip8Interpreter.h"
+#include <QThread>
+#include <QImage>
+#include "emulator.h"
+#include "latency.h"
 
 
 class App : public QWidget {
@@ -25,29 +28,20 @@ public:
     // 7 8 9 E                A S D F
     // A 0 B F                Z X C V
     //
-    std::map<int, int> keyMap{
-            {Qt::Key_1, 0x1},
-            {Qt::Key_2, 0x2},
-            {Qt::Key_3, 0x3},
-            {Qt::Key_4, 0xC},
-
-            {Qt::Key_Q, 0x4},
-            {Qt::Key_W, 0x5},
-            {Qt::Key_E, 0x6},
-            {Qt::Key_R, 0xD},
-
-            {Qt::Key_A, 0x7},
-            {Qt::Key_S, 0x8},
-            {Qt::Key_D, 0x9},
-            {Qt::Key_F, 0xE},
-
-            {Qt::Key_Z, 0xA},
-            {Qt::Key_X, 0x0},
-            {Qt::Key_C, 0xB},
-            {Qt::Key_V, 0xF},
-    };
-
-    explicit App(QWidget *parent = nullptr);
+    // Qt key -> CHIP-8 key, -1 for none. the keys used are ASCII codes.
+    std::array<int8_t, 128> keyTable;
+
+    // hold to run in turbo mode.
+    const static int turboKey = Qt::Key_Tab;
+    // hold to step back through the last frames.
+    const static int rewindKey = Qt::Key_Backspace;
+    const static int quickSaveKey = Qt::Key_F5;
+    const static int quickLoadKey = Qt::Key_F9;
+    const static int saveProfileKey = Qt::Key_F12;
+    const static int saveTraceKey = Qt::Key_F10;
+    const static int traceKey = Qt::Key_F11;
+
+    explicit App(const EmulatorOptions &options = {}, QWidget *parent = nullptr);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
@@ -59,20 +53,49 @@ protected:
     void paintEvent(QPaintEvent *event) override;
 
 private:
-    QPixmap pixmap;
-    Chip8Interpreter *inter;
+    // the screen at one bit per pixel, scaled to the window when painted.
+    QImage image;
+    // frames from the emulation thread, only the latest is presented.
+    TripleBuffer<Frame> frames;
+    // keys down, read by the emulation thread.
+    Keypad keypad;
+    // key press to screen over the session, printed on close.
+    LatencyProbe latency;
+    // pressedAt of the last probe added to latency.
+    int64_t probedAt{0};
+    // toggled by traceKey.
+    bool tracing;
+    QThread thread;
+    Emulator *emulator;
 
 signals:
 
-    void KeyDown(int key);
+    void Turbo(bool enabled);
+
+    void Rewind(bool enabled);
+
+    void QuickSave();
+
+    void QuickLoad();
 
-    void KeyUp(int key);
+    void SaveProfile();
+
+    void Trace(bool enabled);
+
+    void SaveTrace();
 
 public slots:
 
-    void draw(std::array<std::array<bool, Chip8Interpreter::screenWidth>, Chip8Interpreter::screenHeight> buffer);
+    // schedule a repaint for the latest frame.
+    void frameReady();
+
+    // copy the dirty rows of frame into image.
+    void draw(const Frame &frame);
 
     void beep(int milliseconds);
+
+    void stats(double framesPerSecond, double instructionsPerSecond, double idleFraction,
+               double rewindSeconds, qulonglong rewindUsed, qulonglong rewindBudget);
 };
 
 #endif // APP_H
@@ -0,0 +1,335 @@
+// chip8-batch: run many jobs headless and uncapped on every core.
+//
+// usage: chip8-batch <manifest> [--engine=interpreter|block|jit|aot] [--threads=N] [--frames=N] [--ipf=N]
+//                   [--json=<file>] [--screens=<directory>]
+//
+// the manifest has a job per line, tab separated: ROM, then optionally
+// movie, seed and frame count, "-" for a default. '#' starts a comment,
+// relative paths are relative to the manifest.
+//   rom/Pong.ch8	-	7	3600
+//   rom/Breakout.ch8	breakout.mov
+// a job with a movie replays it: seed, ipf and key events from the movie,
+// every frame verified against it, all of its frames by default. a job
+// without one runs --frames frames (3600) at --ipf (10) with no keys, seed 0.
+//
+// jobs run longest first on a WorkPool, a fresh core per job. prints the
+// final state hash and time of every job; --json adds the final screens,
+// --screens writes them as <line>.pbm. exits with 1 when a job fails to
+// load or differs from its movie.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chip8interpreter.h"
+#include "cli.h"
+#include "movie.h"
+#include "workpool.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Job {
+    // of the manifest.
+    int line;
+    std::string rom;
+    std::string movie;
+    // -1: from the movie, or 0.
+    int64_t seed{-1};
+    // -1: from the movie, or --frames.
+    int64_t frames{-1};
+};
+
+struct JobResult {
+    // empty when the job ran.
+    std::string error;
+    uint64_t frames{0};
+    // first frame differing from the movie, -1 when none.
+    int64_t mismatch{-1};
+    uint64_t hash{0};
+    uint64_t instructions{0};
+    double seconds{0};
+    Chip8State::Screen screen{};
+};
+
+struct Options {
+    Engine engine{Engine::Interpreter};
+    int64_t frames{3600};
+    int cyclesPerFrame{10};
+};
+
+static std::vector<std::string> Split(const std::string &line, char separator) {
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, separator)) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+static bool LoadManifest(const std::string &file, std::vector<Job> &jobs) {
+    std::ifstream stream(file);
+    if (!stream.is_open()) {
+        return false;
+    }
+    std::filesystem::path base = std::filesystem::path(file).parent_path();
+    auto resolve = [&base](const std::string &path) {
+        return std::filesystem::path(path).is_absolute() ? path : (base / path).string();
+    };
+    std::string line;
+    int number = 0;
+    while (std::getline(stream, line)) {
+        number++;
+        line = line.substr(0, line.find('#'));
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.find_first_not_of(" \t") == std::string::npos) {
+            continue;
+        }
+        std::vector<std::string> fields = Split(line, '\t');
+        if (fields.size() > 4 || fields[0].empty()) {
+            std::cout << file << ":" << number << ": expected rom [movie [seed [frames]]]" << std::endl;
+            return false;
+        }
+        Job job{number, resolve(fields[0]), "", -1, -1};
+        if (fields.size() > 1 && fields[1] != "-" && !fields[1].empty()) {
+            job.movie = resolve(fields[1]);
+        }
+        bool valid = true;
+        if (fields.size() > 2 && fields[2] != "-" && !fields[2].empty()) {
+            valid &= ParseNumber<int64_t>(fields[2], 0, job.seed);
+        }
+        if (fields.size() > 3 && fields[3] != "-" && !fields[3].empty()) {
+            valid &= ParseNumber<int64_t>(fields[3], 0, job.frames);
+        }
+        if (!valid) {
+            std::cout << file << ":" << number << ": bad number" << std::endl;
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+static JobResult RunJob(const Job &job, const Options &options) {
+    JobResult result;
+    auto core = std::make_unique<Chip8Interpreter>();
+    if (!core->Load(job.rom)) {
+        result.error = "fail to load rom";
+        return result;
+    }
+    core->engine = options.engine;
+
+    Movie movie;
+    if (!job.movie.empty() && !movie.Load(job.movie)) {
+        result.error = "fail to load movie";
+        return result;
+    }
+    if (job.movie.empty()) {
+        movie.cyclesPerFrame = options.cyclesPerFrame;
+        movie.seed = 0;
+    }
+    // another seed than the movie's makes another run, not verified.
+    bool verify = !job.movie.empty() && (job.seed < 0 || (uint64_t) job.seed == movie.seed);
+    if (job.seed >= 0) {
+        movie.seed = (uint64_t) job.seed;
+    }
+    int64_t frames = job.frames >= 0 ? job.frames : job.movie.empty() ? options.frames : (int64_t) movie.hashes.size();
+
+    auto start = Clock::now();
+    movie.Start(*core);
+    size_t next = 0;
+    for (int64_t frame = 0; frame < frames; frame++) {
+        next = movie.ApplyEvents(*core, frame, next);
+        core->RunFrame();
+        if (verify && result.mismatch < 0 && frame < (int64_t) movie.hashes.size() &&
+            StateHash(*core) != movie.hashes[frame]) {
+            result.mismatch = frame;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.frames = frames;
+    result.hash = StateHash(*core);
+    result.instructions = core->instructionCount;
+    result.screen = core->BUFFER;
+    return result;
+}
+
+// binary PBM, 1 is black: set pixels are written inverted.
+static bool SaveScreen(const std::string &file, const Chip8State::Screen &screen) {
+    std::ofstream stream(file, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!stream.is_open()) {
+        return false;
+    }
+    stream << "P4\n" << Chip8State::screenWidth << " " << Chip8State::screenHeight << "\n";
+    for (uint64_t row: screen) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            stream.put((char) ~(row >> shift));
+        }
+    }
+    return stream.good();
+}
+
+static std::string Hex(uint64_t value) {
+    std::ostringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << value;
+    return out.str();
+}
+
+// the contents of a JSON string spelling text.
+static std::string Escape(const std::string &text) {
+    std::string out;
+    for (char c: text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char) c < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned) c);
+            out += buffer;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+static void WriteJson(std::ostream &out, const std::vector<Job> &jobs, const std::vector<JobResult> &results,
+                      unsigned threads, double seconds) {
+    out << "{\n";
+    out << "  \"threads\": " << threads << ", \"seconds\": " << seconds << ",\n";
+    out << "  \"jobs\": [";
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const Job &job = jobs[i];
+        const JobResult &result = results[i];
+        out << (i > 0 ? ",\n    {" : "\n    {");
+        out << "\"line\": " << job.line << ", \"rom\": \"" << Escape(job.rom) << "\", \"movie\": \""
+            << Escape(job.movie) << "\"";
+        if (!result.error.empty()) {
+            out << ", \"error\": \"" << Escape(result.error) << "\"}";
+            continue;
+        }
+        out << ", \"frames\": " << result.frames << ", \"mismatch\": " << result.mismatch
+            << ", \"hash\": \"" << Hex(result.hash) << "\", \"instructions\": " << result.instructions
+            << ", \"seconds\": " << result.seconds << ",\n     \"screen\": [";
+        for (size_t row = 0; row < result.screen.size(); row++) {
+            out << (row > 0 ? ", \"" : "\"") << Hex(result.screen[row]) << "\"";
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static int Usage() {
+    std::cout << "usage: chip8-batch <manifest> [--engine=interpreter|block|jit|aot] [--threads=N] [--frames=N]"
+                 " [--ipf=N] [--json=<file>] [--screens=<directory>]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        return Usage();
+    }
+    std::string manifest = argv[1];
+    Options options;
+    unsigned threads = 0;
+    std::string json;
+    std::string screens;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (ParseEngine(arg, options.engine)) {
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            valid = ParseNumber<unsigned>(arg.substr(10), 1, threads);
+        } else if (arg.rfind("--frames=", 0) == 0) {
+            valid = ParseNumber<int64_t>(arg.substr(9), 0, options.frames);
+        } else if (arg.rfind("--ipf=", 0) == 0) {
+            valid = ParseNumber(arg.substr(6), 1, options.cyclesPerFrame);
+        } else if (arg.rfind("--json=", 0) == 0 && arg.size() > 7) {
+            json = arg.substr(7);
+        } else if (arg.rfind("--screens=", 0) == 0 && arg.size() > 10) {
+            screens = arg.substr(10);
+        } else {
+            std::cout << "unknown argument: " << arg << std::endl;
+            return Usage();
+        }
+        if (!valid) {
+            std::cout << "invalid argument: " << arg << std::endl;
+            return Usage();
+        }
+    }
+
+    std::vector<Job> jobs;
+    if (!LoadManifest(manifest, jobs)) {
+        std::cout << "fail to load manifest: " << manifest << std::endl;
+        return 1;
+    }
+
+    // longest first, by frames when they are known before loading the movie.
+    std::vector<size_t> order(jobs.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    auto length = [&](size_t i) {
+        return jobs[i].frames >= 0 ? jobs[i].frames : jobs[i].movie.empty() ? options.frames : INT64_MAX;
+    };
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return length(a) > length(b);
+    });
+
+    WorkPool pool(threads);
+    std::vector<JobResult> results(jobs.size());
+    auto start = Clock::now();
+    pool.Run(order, [&](size_t job, unsigned) {
+        results[job] = RunJob(jobs[job], options);
+    });
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    bool failed = false;
+    uint64_t frames = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const JobResult &result = results[i];
+        std::cout << jobs[i].line << "\t";
+        if (!result.error.empty()) {
+            std::cout << result.error << "\t" << jobs[i].rom << std::endl;
+            failed = true;
+            continue;
+        }
+        std::cout << Hex(result.hash) << "\t" << result.frames << " frames\t" << result.seconds * 1000 << " ms\t";
+        if (result.mismatch >= 0) {
+            std::cout << "differs at frame " << result.mismatch << "\t";
+            failed = true;
+        }
+        std::cout << jobs[i].rom << std::endl;
+        frames += result.frames;
+        if (!screens.empty()) {
+            std::string file = (std::filesystem::path(screens) / (std::to_string(jobs[i].line) + ".pbm")).string();
+            if (!SaveScreen(file, result.screen)) {
+                std::cout << "fail to save screen: " << file << std::endl;
+                failed = true;
+            }
+        }
+    }
+    std::cout << jobs.size() << " jobs on " << pool.Threads() << " threads (" << pool.Steals() << " stolen) in "
+              << seconds << " s, " << frames / seconds << " frames/s." << std::endl;
+
+    if (!json.empty()) {
+        std::ofstream stream(json, std::ios::out | std::ios::trunc);
+        WriteJson(stream, jobs, results, pool.Threads(), seconds);
+        if (!stream.good()) {
+            std::cout << "fail to write " << json << std::endl;
+            return 1;
+        }
+    }
+    return failed ? 1 : 0;
+}
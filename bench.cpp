@@ -0,0 +1,694 @@
+// chip8_bench: headless benchmarks of the core.
+//
+// usage: chip8_bench [rom directory] [--frames=N] [--repetitions=N] [--json=<file>] [--differential]
+//
+// runs generated ROMs stressing one kind of instruction, and every ROM of
+// the rom directory, with each engine: warmup frames, then repetitions of
+// frames at 1000 instructions per frame with idle loop skipping off. the
+// state hash at the end must be the same for every engine of a workload.
+// Breakout's states of every frame are packed into CompactStates and back.
+// then each workload on 256 lanes of a Lockstep against as many
+// interpreters, every lane verified after every frame.
+// --json writes the results for tracking regressions across versions.
+// --differential times nothing: it runs every workload on every engine and
+// a lane of Lockstep next to the interpreter, with random keys, and exits
+// with 1 at the first frame after which their machines differ.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "chip8interpreter.h"
+#include "cli.h"
+#include "compactstate.h"
+#include "movie.h"
+#include "jit.h"
+#include "lockstep.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double Seconds(Clock::time_point since) {
+    return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+// the previous DRW: one bool per pixel, branch per pixel.
+struct BoolScreen {
+    std::array<std::array<bool, Chip8State::screenWidth>, Chip8State::screenHeight> BUFFER{};
+    std::array<uint8_t, 16> V{};
+    bool drawFlag{false};
+
+    void Draw(const uint8_t *sprite, Instruction ins) {
+        int startX = V[ins.X];
+        int startY = V[ins.Y];
+        V[0x0F] = 0;
+        for (int i = 0; i < ins.N; i++) {
+            uint8_t spriteLine = sprite[i];
+            for (int j = 0; j < 8; j++) {
+                int x = (startY + i) % Chip8State::screenHeight;
+                int y = (startX + j) % Chip8State::screenWidth;
+                bool currentPix = BUFFER[x][y];
+                bool spritePix = spriteLine & (0x80 >> j);
+                if (currentPix != spritePix) {
+                    drawFlag = true;
+                }
+                if (currentPix && spritePix) {
+                    V[0xF] = 1;
+                }
+                BUFFER[x][y] = (bool) (currentPix ^ spritePix);
+            }
+        }
+    }
+};
+
+// D01F sprites of the font at every position, old and new screen layout.
+static double BenchDraw() {
+    const int iterations = 2000000;
+    Instruction ins = ParseInstruction(0xD01F);
+
+    Chip8Interpreter core;
+    core.I = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        core.V[0] = i;
+        core.V[1] = i >> 6;
+        core.DRW_Vx_Vy_N(ins);
+    }
+    double packed = Seconds(start);
+
+    BoolScreen screen;
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        screen.V[0] = i;
+        screen.V[1] = i >> 6;
+        screen.Draw(&core.RAM[0], ins);
+    }
+    double bools = Seconds(start);
+
+    std::cout << "DRW 8x15, packed rows: " << packed * 1e9 / iterations << " ns, bool pixels: "
+              << bools * 1e9 / iterations << " ns" << std::endl;
+    return packed * 1e9 / iterations;
+}
+
+struct Workload {
+    std::string name;
+    std::vector<uint8_t> rom;
+};
+
+static std::vector<uint8_t> Assemble(const std::vector<uint16_t> &code) {
+    std::vector<uint8_t> rom;
+    for (uint16_t opcode: code) {
+        rom.push_back(opcode >> 8);
+        rom.push_back(opcode & 0xFF);
+    }
+    return rom;
+}
+
+// ROMs stressing one kind of instruction, each an endless loop that never goes idle.
+static std::vector<Workload> SyntheticWorkloads() {
+    std::vector<Workload> workloads;
+
+    // 8xyN arithmetic on eight registers.
+    workloads.push_back({"alu", Assemble({
+            0x6001, 0x6107, 0x6213, 0x6339, 0x6455, 0x6577, 0x669B, 0x67F1,
+            // 0x210
+            0x8014, 0x8125, 0x8231, 0x8342, 0x8453, 0x8506, 0x860E, 0x8707,
+            0x8014, 0x8124, 0x8234, 0x8344, 0x8454, 0x8564, 0x8674, 0x8704,
+            0x7011, 0x7113, 0x1210,
+    })});
+
+    // 8x5 font sprites all over the screen.
+    workloads.push_back({"drw", Assemble({
+            0x6000, 0x6100, 0x6200,
+            // 0x206
+            0xF229, 0xD015, 0x7009, 0x7105, 0x7201, 0x420F, 0x6200,
+            0xF229, 0xD015, 0x7009, 0x7105, 0x7201, 0x420F, 0x6200,
+            0x1206,
+    })});
+
+    // Fx55/Fx65 of all registers, outside the code.
+    workloads.push_back({"memory", Assemble({
+            // 0x200
+            0xA300, 0xFF55, 0xA310, 0xFF55, 0xA300, 0xFF65, 0xA310, 0xFF65,
+            0x7001, 0x7F03, 0x1200,
+    })});
+
+    // three levels of calls and returns.
+    workloads.push_back({"call", Assemble({
+            // 0x200
+            0x2208, 0x7001, 0x2208, 0x1200,
+            // 0x208
+            0x220C, 0x00EE,
+            // 0x20C
+            0x2210, 0x00EE,
+            // 0x210
+            0x7101, 0x00EE,
+    })});
+    return workloads;
+}
+
+// stores, loads, BCD and sprites with I across the end of RAM and past it,
+// where addresses wrap around. only run by --differential.
+static Workload WrapWorkload() {
+    return {"wrap", Assemble({
+            // 0x200
+            0x7001, 0x7103, 0xAFFE, 0xF355, 0xF365, 0x6CFF, 0xFC1E, 0xF233,
+            0xF065, 0xD015, 0xAFFF, 0xF133, 0xD125, 0x1200,
+    })};
+}
+
+// rewrites the immediate of an instruction once its block is hot: the
+// compiled and translated code of the block must be dropped. only run by
+// --differential.
+static Workload SelfModifyingWorkload() {
+    return {"self-modifying", Assemble({
+            // 0x200: every 32 loops
+            0x7001, 0x8300, 0x6A1F, 0x83A2, 0x3300, 0x1210,
+            // 0x20C: store V0 into the nn of 0x212
+            0xA213, 0xF055,
+            // 0x210
+            0x7401, 0x6100, 0x8214, 0x1200,
+    })};
+}
+
+static std::vector<Workload> RomWorkloads(const std::string &directory) {
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    for (const auto &entry: std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() == ".ch8") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<Workload> workloads;
+    for (const auto &file: files) {
+        std::ifstream stream(file, std::ios::binary | std::ios::in);
+        std::vector<uint8_t> rom((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        workloads.push_back({file.filename().string(), rom});
+    }
+    return workloads;
+}
+
+struct Statistics {
+    double mean;
+    double min;
+    double max;
+    double stddev;
+};
+
+static Statistics Summarize(const std::vector<double> &samples) {
+    Statistics statistics{0, samples[0], samples[0], 0};
+    for (double sample: samples) {
+        statistics.mean += sample;
+        statistics.min = std::min(statistics.min, sample);
+        statistics.max = std::max(statistics.max, sample);
+    }
+    statistics.mean /= samples.size();
+    for (double sample: samples) {
+        statistics.stddev += (sample - statistics.mean) * (sample - statistics.mean);
+    }
+    statistics.stddev = std::sqrt(statistics.stddev / samples.size());
+    return statistics;
+}
+
+struct Result {
+    std::string workload;
+    std::string engine;
+    Statistics nsPerInstruction;
+    Statistics mips;
+    Statistics framesPerSecond;
+    uint64_t hash;
+    // the same frames again with idle loops skipped.
+    double idleFraction;
+    double idleFramesPerSecond;
+};
+
+struct Options {
+    int warmup{200};
+    int frames{2000};
+    int repetitions{5};
+};
+
+static Result BenchWorkload(const Workload &workload, Engine engine, const char *engineName, const Options &options) {
+    const int cyclesPerFrame = 1000;
+
+    Result result{workload.name, engineName, {}, {}, {}, 0, 0, 0};
+    std::vector<double> nsPerInstruction, mips, framesPerSecond;
+    {
+        Chip8Interpreter core;
+        core.Load(workload.rom.data(), workload.rom.size());
+        core.Seed(1);
+        core.engine = engine;
+        core.cyclesPerFrame = cyclesPerFrame;
+        core.skipIdle = false;
+        for (int i = 0; i < options.warmup; i++) {
+            core.RunFrame();
+        }
+        for (int repetition = 0; repetition < options.repetitions; repetition++) {
+            uint64_t instructions = core.instructionCount;
+            auto start = Clock::now();
+            for (int i = 0; i < options.frames; i++) {
+                core.RunFrame();
+            }
+            double seconds = Seconds(start);
+            instructions = core.instructionCount - instructions;
+            nsPerInstruction.push_back(seconds * 1e9 / instructions);
+            mips.push_back(instructions / seconds / 1e6);
+            framesPerSecond.push_back(options.frames / seconds);
+        }
+        result.hash = StateHash(core);
+    }
+    result.nsPerInstruction = Summarize(nsPerInstruction);
+    result.mips = Summarize(mips);
+    result.framesPerSecond = Summarize(framesPerSecond);
+
+    Chip8Interpreter core;
+    core.Load(workload.rom.data(), workload.rom.size());
+    core.Seed(1);
+    core.engine = engine;
+    core.cyclesPerFrame = cyclesPerFrame;
+    int frames = options.warmup + options.frames * options.repetitions;
+    auto start = Clock::now();
+    for (int i = 0; i < frames; i++) {
+        core.RunFrame();
+    }
+    result.idleFramesPerSecond = frames / Seconds(start);
+    result.idleFraction = (double) core.idleInstructionCount / core.instructionCount;
+    return result;
+}
+
+struct LockstepResult {
+    std::string workload;
+    int lanes;
+    // millions of instructions per second, over all lanes.
+    double mips;
+    double scalarMips;
+    double lanesPerGroup;
+    double convergedFraction;
+    bool agree;
+};
+
+// the same ROM on many lanes with their own seeds and keys, as a Lockstep
+// and as a Chip8Interpreter per lane. every lane must hash the same after
+// every frame.
+static LockstepResult BenchLockstep(const Workload &workload, const Options &options) {
+    const int lanes = 256;
+    const int cyclesPerFrame = 100;
+    const int frames = options.frames / 4;
+
+    Lockstep lockstep(lanes);
+    lockstep.Load(workload.rom.data(), workload.rom.size());
+    lockstep.cyclesPerFrame = cyclesPerFrame;
+    std::vector<std::unique_ptr<Chip8Interpreter>> cores;
+    for (int lane = 0; lane < lanes; lane++) {
+        cores.push_back(std::make_unique<Chip8Interpreter>());
+        cores[lane]->Load(workload.rom.data(), workload.rom.size());
+        cores[lane]->Seed(lane);
+        cores[lane]->cyclesPerFrame = cyclesPerFrame;
+        cores[lane]->skipIdle = false;
+        lockstep.Seed(lane, lane);
+    }
+
+    LockstepResult result{workload.name, lanes, 0, 0, 0, 0, true};
+    double seconds = 0;
+    double scalarSeconds = 0;
+    Chip8State state;
+    for (int frame = 0; frame < frames; frame++) {
+        // every few frames a lane presses or releases a key of its own.
+        if (frame % 8 == 0) {
+            for (int lane = 0; lane < lanes; lane++) {
+                int key = (lane * 7 + frame / 8) % 16;
+                if ((lane + frame / 8) % 3 == 0) {
+                    lockstep.KeyDown(lane, key);
+                    cores[lane]->KeyDown(key);
+                } else {
+                    lockstep.KeyUp(lane, key);
+                    cores[lane]->KeyUp(key);
+                }
+            }
+        }
+        auto start = Clock::now();
+        lockstep.RunFrame();
+        seconds += Seconds(start);
+        start = Clock::now();
+        for (auto &core: cores) {
+            core->RunFrame();
+        }
+        scalarSeconds += Seconds(start);
+
+        for (int lane = 0; lane < lanes && result.agree; lane++) {
+            lockstep.GetState(lane, state);
+            if (StateHash(state) != StateHash(*cores[lane])) {
+                std::cout << workload.name << " [lockstep]: lane " << lane << " differs at frame " << frame
+                          << "." << std::endl;
+                result.agree = false;
+            }
+        }
+    }
+    double instructions = (double) lanes * frames * cyclesPerFrame;
+    result.mips = instructions / seconds / 1e6;
+    result.scalarMips = instructions / scalarSeconds / 1e6;
+    result.lanesPerGroup = (double) lanes * lockstep.stats.steps / lockstep.stats.groups;
+    result.convergedFraction = (double) lockstep.stats.converged / lockstep.stats.steps;
+    return result;
+}
+
+struct CompactResult {
+    double bytes;
+    double packNs;
+    double unpackNs;
+    bool agree;
+};
+
+// CompactStates of every frame of a run with keys, each verified to
+// unpack to the state it packed.
+static CompactResult BenchCompact(const std::string &file) {
+    const int frames = 20000;
+
+    Chip8Interpreter core;
+    core.Load(file);
+    core.Seed(1);
+    auto image = std::make_shared<const RomImage>(core);
+    std::vector<CompactState> states;
+    states.reserve(frames);
+    auto unpacked = std::make_unique<Chip8State>();
+
+    CompactResult result{0, 0, 0, true};
+    double packSeconds = 0;
+    double unpackSeconds = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        if (frame % 20 == 0) {
+            core.KeyUp(frame / 20 % 3 == 0 ? 4 : 6);
+            core.KeyDown(frame / 20 % 3 == 0 ? 6 : 4);
+        }
+        core.RunFrame();
+        auto start = Clock::now();
+        states.emplace_back(image);
+        states.back().Pack(core);
+        packSeconds += Seconds(start);
+        start = Clock::now();
+        states.back().Unpack(*unpacked);
+        unpackSeconds += Seconds(start);
+        if (result.agree && StateHash(*unpacked) != StateHash(core)) {
+            std::cout << "compact state differs at frame " << frame << "." << std::endl;
+            result.agree = false;
+        }
+    }
+    size_t bytes = 0;
+    for (const CompactState &state: states) {
+        bytes += state.Bytes();
+    }
+    result.bytes = (double) bytes / frames;
+    result.packNs = packSeconds * 1e9 / frames;
+    result.unpackNs = unpackSeconds * 1e9 / frames;
+    std::cout << "compact state: " << result.bytes << " bytes on average against " << sizeof(Chip8Snapshot)
+              << ", pack: " << result.packNs << " ns, unpack: " << result.unpackNs << " ns" << std::endl;
+    return result;
+}
+
+static void WriteStatistics(std::ostream &out, const char *name, const Statistics &statistics) {
+    out << "\"" << name << "\": {\"mean\": " << statistics.mean << ", \"min\": " << statistics.min
+        << ", \"max\": " << statistics.max << ", \"stddev\": " << statistics.stddev << "}";
+}
+
+static void WriteJson(std::ostream &out, const Options &options, const std::vector<Result> &results,
+                      const std::vector<LockstepResult> &lockstepResults, double drawNs,
+                      std::pair<double, double> snapshotNs, const CompactResult &compact) {
+    out << "{\n";
+    out << "  \"instructionsPerFrame\": 1000, \"warmup\": " << options.warmup << ", \"frames\": " << options.frames
+        << ", \"repetitions\": " << options.repetitions << ",\n";
+    out << "  \"drawNs\": " << drawNs << ", \"saveStateNs\": " << snapshotNs.first
+        << ", \"loadStateNs\": " << snapshotNs.second << ",\n";
+    out << "  \"compactBytes\": " << compact.bytes << ", \"packNs\": " << compact.packNs
+        << ", \"unpackNs\": " << compact.unpackNs << ",\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+        out << (i > 0 ? ",\n    {" : "\n    {");
+        out << "\"workload\": \"" << result.workload << "\", \"engine\": \"" << result.engine << "\", ";
+        WriteStatistics(out, "nsPerInstruction", result.nsPerInstruction);
+        out << ", ";
+        WriteStatistics(out, "mips", result.mips);
+        out << ", ";
+        WriteStatistics(out, "framesPerSecond", result.framesPerSecond);
+        out << ", \"hash\": \"" << std::hex << std::setw(16) << std::setfill('0') << result.hash << std::dec << "\"";
+        out << ", \"idleFraction\": " << result.idleFraction << ", \"idleFramesPerSecond\": " << result.idleFramesPerSecond;
+        out << "}";
+    }
+    out << "\n  ],\n";
+    out << "  \"lockstep\": [";
+    for (size_t i = 0; i < lockstepResults.size(); i++) {
+        const LockstepResult &result = lockstepResults[i];
+        out << (i > 0 ? ",\n    {" : "\n    {");
+        out << "\"workload\": \"" << result.workload << "\", \"lanes\": " << result.lanes
+            << ", \"mips\": " << result.mips << ", \"scalarMips\": " << result.scalarMips
+            << ", \"lanesPerGroup\": " << result.lanesPerGroup
+            << ", \"convergedFraction\": " << result.convergedFraction
+            << ", \"agree\": " << (result.agree ? "true" : "false") << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// SaveState/LoadState of a running machine.
+// returns nanoseconds of a save and of a load.
+static std::pair<double, double> BenchSnapshot(const std::string &file) {
+    const int iterations = 1000000;
+
+    Chip8Interpreter core;
+    core.Load(file);
+    core.cyclesPerFrame = 1000;
+    for (int i = 0; i < 100; i++) {
+        core.RunFrame();
+    }
+    auto snapshot = std::make_unique<Chip8Snapshot>();
+
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        core.SaveState(*snapshot);
+    }
+    double save = Seconds(start);
+
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        core.LoadState(*snapshot);
+    }
+    double load = Seconds(start);
+
+    std::cout << "snapshot of " << sizeof(Chip8Snapshot) << " bytes, save: " << save * 1e9 / iterations
+              << " ns, load: " << load * 1e9 / iterations << " ns" << std::endl;
+    return {save * 1e9 / iterations, load * 1e9 / iterations};
+}
+
+// the first member of Chip8State differing between a and b, nullptr when
+// none. member by member: the padding between them isn't part of the state.
+static const char *StateDifference(const Chip8State &a, const Chip8State &b) {
+    if (std::memcmp(&a.V, &b.V, sizeof(a.V)) != 0) {
+        return "V";
+    }
+    if (std::memcmp(&a.DT, &b.DT, sizeof(a.DT)) != 0) {
+        return "DT";
+    }
+    if (std::memcmp(&a.ST, &b.ST, sizeof(a.ST)) != 0) {
+        return "ST";
+    }
+    if (std::memcmp(&a.I, &b.I, sizeof(a.I)) != 0) {
+        return "I";
+    }
+    if (std::memcmp(&a.PC, &b.PC, sizeof(a.PC)) != 0) {
+        return "PC";
+    }
+    if (std::memcmp(&a.SP, &b.SP, sizeof(a.SP)) != 0) {
+        return "SP";
+    }
+    if (std::memcmp(&a.STACK, &b.STACK, sizeof(a.STACK)) != 0) {
+        return "STACK";
+    }
+    if (std::memcmp(&a.RAM, &b.RAM, sizeof(a.RAM)) != 0) {
+        return "RAM";
+    }
+    if (std::memcmp(&a.INPUTS, &b.INPUTS, sizeof(a.INPUTS)) != 0) {
+        return "INPUTS";
+    }
+    if (std::memcmp(&a.BUFFER, &b.BUFFER, sizeof(a.BUFFER)) != 0) {
+        return "BUFFER";
+    }
+    if (std::memcmp(&a.RND, &b.RND, sizeof(a.RND)) != 0) {
+        return "RND";
+    }
+    return nullptr;
+}
+
+// runs workload on every engine next to the interpreter, with the same
+// random keys held for 8 frames at a time, and compares the whole machine
+// after every frame. false at the first difference.
+static bool Differential(const Workload &workload, const std::vector<std::pair<Engine, const char *>> &engines,
+                         const Options &options) {
+    const int cyclesPerFrame = 100;
+
+    std::vector<std::unique_ptr<Chip8Interpreter>> cores;
+    for (const auto &engine: engines) {
+        auto core = std::make_unique<Chip8Interpreter>();
+        core->Load(workload.rom.data(), workload.rom.size());
+        core->Seed(1);
+        core->engine = engine.first;
+        core->cyclesPerFrame = cyclesPerFrame;
+        core->skipIdle = false;
+        cores.push_back(std::move(core));
+    }
+    // and a lane of Lockstep, which must match the interpreter as well.
+    Lockstep lockstep(1);
+    lockstep.Load(workload.rom.data(), workload.rom.size());
+    lockstep.Seed(0, 1);
+    lockstep.cyclesPerFrame = cyclesPerFrame;
+    Chip8State lane;
+
+    uint64_t random = 0x9E3779B97F4A7C15;
+    int frames = options.warmup + options.frames;
+    for (int frame = 0; frame < frames; frame++) {
+        if (frame % 8 == 0) {
+            random ^= random >> 12;
+            random ^= random << 25;
+            random ^= random >> 27;
+            // one key, or none.
+            uint32_t key = (uint32_t) ((random * 0x2545F4914F6CDD1D) >> 59);
+            for (auto &core: cores) {
+                core->INPUTS = key < 16 ? (uint16_t) (1u << key) : 0;
+            }
+            lockstep.SetKeys(0, key < 16 ? (uint16_t) (1u << key) : 0);
+        }
+        for (auto &core: cores) {
+            core->RunFrame();
+        }
+        lockstep.RunFrame();
+        lockstep.GetState(0, lane);
+        const char *laneDifference = StateDifference(*cores[0], lane);
+        if (laneDifference != nullptr) {
+            std::cout << workload.name << " [lockstep]: " << laneDifference
+                      << " differs from the interpreter after frame " << frame << std::endl;
+            return false;
+        }
+        for (size_t i = 1; i < cores.size(); i++) {
+            const char *difference = StateDifference(*cores[0], *cores[i]);
+            if (difference != nullptr) {
+                std::cout << workload.name << " [" << engines[i].second << "]: " << difference
+                          << " differs from the interpreter after frame " << frame << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << workload.name << ": every engine matches the interpreter for " << frames << " frames" << std::endl;
+    return true;
+}
+
+static int Usage() {
+    std::cout << "usage: chip8_bench [rom directory] [--frames=N] [--repetitions=N] [--json=<file>] [--differential]"
+              << std::endl;
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    std::string roms = CHIP8_ROM_DIR;
+    std::string json;
+    bool differential = false;
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (arg.rfind("--frames=", 0) == 0) {
+            valid = ParseNumber(arg.substr(9), 1, options.frames);
+        } else if (arg.rfind("--repetitions=", 0) == 0) {
+            valid = ParseNumber(arg.substr(14), 1, options.repetitions);
+        } else if (arg.rfind("--json=", 0) == 0 && arg.size() > 7) {
+            json = arg.substr(7);
+        } else if (arg == "--differential") {
+            differential = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cout << "unknown argument: " << arg << std::endl;
+            return Usage();
+        } else {
+            roms = arg;
+        }
+        if (!valid) {
+            std::cout << "invalid argument: " << arg << std::endl;
+            return Usage();
+        }
+    }
+
+    std::vector<std::pair<Engine, const char *>> engines{
+            {Engine::Interpreter, "interpreter"},
+            {Engine::Block, "block"},
+#ifdef CHIP8_JIT_AVAILABLE
+            {Engine::Jit, "jit"},
+#endif
+    };
+    std::vector<Workload> workloads = SyntheticWorkloads();
+    for (Workload &workload: RomWorkloads(roms)) {
+        workloads.push_back(workload);
+    }
+
+    if (differential) {
+        workloads.push_back(SelfModifyingWorkload());
+        workloads.push_back(WrapWorkload());
+        for (const Workload &workload: workloads) {
+            if (!Differential(workload, engines, options)) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    double drawNs = BenchDraw();
+    std::pair<double, double> snapshotNs = BenchSnapshot(roms + "/Breakout (Brix hack) [David Winter, 1997].ch8");
+    CompactResult compact = BenchCompact(roms + "/Breakout (Brix hack) [David Winter, 1997].ch8");
+
+    std::vector<Result> results;
+    bool agree = compact.agree;
+    for (const Workload &workload: workloads) {
+        for (const auto &engine: engines) {
+            Result result = BenchWorkload(workload, engine.first, engine.second, options);
+            std::cout << workload.name << " [" << result.engine << "]: "
+                      << result.mips.mean << " MIPS (min " << result.mips.min << ", max " << result.mips.max
+                      << ", stddev " << result.mips.stddev << "), "
+                      << result.nsPerInstruction.mean << " ns/instruction, "
+                      << result.framesPerSecond.mean << " frames/s, "
+                      << result.idleFraction * 100 << "% idle: " << result.idleFramesPerSecond << " frames/s"
+                      << std::endl;
+            if (!results.empty() && results.back().workload == workload.name && results.back().hash != result.hash) {
+                std::cout << workload.name << ": engines end in different states." << std::endl;
+                agree = false;
+            }
+            results.push_back(result);
+        }
+    }
+
+    std::vector<LockstepResult> lockstepResults;
+    for (const Workload &workload: workloads) {
+        LockstepResult result = BenchLockstep(workload, options);
+        std::cout << workload.name << " [lockstep x" << result.lanes << "]: " << result.mips << " MIPS, "
+                  << result.scalarMips << " MIPS as separate interpreters, " << result.lanesPerGroup
+                  << " lanes per group, " << result.convergedFraction * 100 << "% converged" << std::endl;
+        agree &= result.agree;
+        lockstepResults.push_back(result);
+    }
+
+    if (!json.empty()) {
+        std::ofstream stream(json, std::ios::out | std::ios::trunc);
+        WriteJson(stream, options, results, lockstepResults, drawNs, snapshotNs, compact);
+        if (!stream.good()) {
+            std::cout << "fail to write " << json << std::endl;
+            return 1;
+        }
+    }
+    return agree ? 0 : 1;
+}
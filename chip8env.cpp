@@ -0,0 +1,166 @@
+#include "chip8env.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "lockstep.h"
+
+struct chip8_env {
+    Lockstep lanes;
+    chip8_env_config config;
+    std::vector<uint16_t> probes;
+    // a lane right after Load, what a reset restores.
+    std::unique_ptr<Chip8State> initial;
+    // value of the reward probe after the last step or reset, by lane.
+    std::vector<uint8_t> rewardBase;
+
+    explicit chip8_env(const chip8_env_config &config) : lanes{config.count}, config{config} {
+    }
+};
+
+static uint8_t Probe(const chip8_env *env, size_t lane, uint16_t address) {
+    if (address >= CHIP8_PROBE_V0) {
+        return env->lanes.Register(lane, address - CHIP8_PROBE_V0);
+    }
+    return env->lanes.Peek(lane, address);
+}
+
+static void Observe(const chip8_env *env, void *observations, uint8_t *probes) {
+    size_t count = env->config.count;
+    if (observations != nullptr) {
+        const uint64_t *screens = env->lanes.Screen(0);
+        if (env->config.observation == CHIP8_OBSERVATION_BITS) {
+            std::memcpy(observations, screens, count * sizeof(Chip8State::Screen));
+        } else {
+            auto out = static_cast<uint8_t *>(observations);
+            for (size_t row = 0; row < count * Chip8State::screenHeight; row++) {
+                for (int column = 0; column < Chip8State::screenWidth; column++) {
+                    *out++ = screens[row] >> (63 - column) & 1;
+                }
+            }
+        }
+    }
+    if (probes != nullptr) {
+        for (size_t lane = 0; lane < count; lane++) {
+            for (uint16_t address: env->probes) {
+                *probes++ = Probe(env, lane, address);
+            }
+        }
+    }
+}
+
+uint32_t chip8_env_version(void) {
+    return CHIP8_ENV_VERSION;
+}
+
+chip8_env *chip8_env_create(const chip8_env_config *config) {
+    if (config == nullptr || config->rom == nullptr || config->count == 0 ||
+        config->observation > CHIP8_OBSERVATION_BYTES ||
+        (config->probe_count > 0 && config->probes == nullptr) ||
+        config->reward_probe >= (int32_t) config->probe_count) {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < config->probe_count; i++) {
+        if (config->probes[i] >= CHIP8_PROBE_V0 + 16) {
+            return nullptr;
+        }
+    }
+
+    // nothing may throw through the C ABI: a count too large to allocate
+    // fails the creation.
+    chip8_env *env = nullptr;
+    try {
+        env = new chip8_env(*config);
+        env->config.frames_per_step = config->frames_per_step > 0 ? config->frames_per_step : 1;
+        env->config.cycles_per_frame = config->cycles_per_frame > 0 ? config->cycles_per_frame : 10;
+        env->probes.assign(config->probes, config->probes + config->probe_count);
+        env->config.rom = nullptr;
+        env->config.probes = nullptr;
+
+        env->lanes.cyclesPerFrame = (int) env->config.cycles_per_frame;
+        env->lanes.Load(config->rom, config->rom_size);
+        env->initial = std::make_unique<Chip8State>();
+        env->lanes.GetState(0, *env->initial);
+        for (size_t lane = 0; lane < config->count; lane++) {
+            env->lanes.Seed(lane, config->seed + lane);
+        }
+        env->rewardBase.resize(config->count);
+        if (config->reward_probe >= 0) {
+            for (size_t lane = 0; lane < config->count; lane++) {
+                env->rewardBase[lane] = Probe(env, lane, env->probes[config->reward_probe]);
+            }
+        }
+    } catch (...) {
+        delete env;
+        return nullptr;
+    }
+    return env;
+}
+
+void chip8_env_destroy(chip8_env *env) {
+    delete env;
+}
+
+uint32_t chip8_env_count(const chip8_env *env) {
+    return env->config.count;
+}
+
+size_t chip8_env_observation_size(const chip8_env *env) {
+    if (env->config.observation == CHIP8_OBSERVATION_BITS) {
+        return sizeof(Chip8State::Screen);
+    }
+    return Chip8State::screenWidth * Chip8State::screenHeight;
+}
+
+int chip8_env_reset(chip8_env *env, const uint8_t *mask, const uint64_t *seeds, void *observations,
+                    uint8_t *probes) {
+    try {
+        for (size_t lane = 0; lane < env->config.count; lane++) {
+            if (mask != nullptr && mask[lane] == 0) {
+                continue;
+            }
+            env->lanes.SetState(lane, *env->initial);
+            env->lanes.Seed(lane, seeds != nullptr ? seeds[lane] : env->config.seed + lane);
+            if (env->config.reward_probe >= 0) {
+                env->rewardBase[lane] = Probe(env, lane, env->probes[env->config.reward_probe]);
+            }
+        }
+        Observe(env, observations, probes);
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int chip8_env_step_batch(chip8_env *env, const uint16_t *actions, void *observations, uint8_t *probes,
+                         float *rewards) {
+    try {
+        size_t count = env->config.count;
+        for (size_t lane = 0; lane < count; lane++) {
+            env->lanes.SetKeys(lane, actions != nullptr ? actions[lane] : 0);
+        }
+        for (uint32_t frame = 0; frame < env->config.frames_per_step; frame++) {
+            env->lanes.RunFrame();
+        }
+        Observe(env, observations, probes);
+
+        if (env->config.reward_probe >= 0) {
+            uint16_t address = env->probes[env->config.reward_probe];
+            for (size_t lane = 0; lane < count; lane++) {
+                uint8_t value = Probe(env, lane, address);
+                if (rewards != nullptr) {
+                    rewards[lane] = (float) value - (float) env->rewardBase[lane];
+                }
+                env->rewardBase[lane] = value;
+            }
+        } else if (rewards != nullptr) {
+            for (size_t lane = 0; lane < count; lane++) {
+                rewards[lane] = 0;
+            }
+        }
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+/* chip8env: batched CHIP-8 environments for reinforcement learning, a C ABI over Lockstep.
+ *
+ * an environment is one machine running the ROM of its batch. a step sets
+ * the keys of every environment from its action, runs frames_per_step
+ * frames, then writes the screens, probes and rewards of every environment
+ * into the buffers given by the caller, environment after environment. no
+ * call but chip8_env_create allocates, and no call lets a C++ exception
+ * out: a call that fails returns NULL or -1.
+ *
+ * one batch is not thread-safe, separate batches are independent.
+ */
+
+#ifndef CHIP8ENV_H
+#define CHIP8ENV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(CHIP8_ENV_BUILD)
+#define CHIP8_ENV_API __declspec(dllexport)
+#else
+#define CHIP8_ENV_API __declspec(dllimport)
+#endif
+#else
+#define CHIP8_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* incremented when a function or a struct changes. */
+#define CHIP8_ENV_VERSION 1
+
+/* probe addresses: RAM below 0x1000, register Vx at CHIP8_PROBE_V0 + x. */
+#define CHIP8_PROBE_V0 0x1000
+
+/* observation formats. */
+enum chip8_observation {
+    /* 32 uint64_t rows, the pixel at column c is bit 63 - c: 256 bytes. */
+    CHIP8_OBSERVATION_BITS = 0,
+    /* a byte per pixel, 0 or 1, row after row: 2048 bytes. */
+    CHIP8_OBSERVATION_BYTES = 1,
+};
+
+typedef struct chip8_env_config {
+    /* the ROM, copied at creation. */
+    const uint8_t *rom;
+    size_t rom_size;
+    /* number of environments. */
+    uint32_t count;
+    /* frames run by a step, 0 for 1. */
+    uint32_t frames_per_step;
+    /* instructions per frame, 0 for 10. */
+    uint32_t cycles_per_frame;
+    /* environment i is seeded with seed + i, unless chip8_env_reset is given seeds. */
+    uint64_t seed;
+    /* an enum chip8_observation. */
+    uint32_t observation;
+    /* bytes read after every step, see CHIP8_PROBE_V0. copied at creation. */
+    const uint16_t *probes;
+    uint32_t probe_count;
+    /* index of the probe whose change over a step is the reward, -1 for none. */
+    int32_t reward_probe;
+} chip8_env_config;
+
+typedef struct chip8_env chip8_env;
+
+/* CHIP8_ENV_VERSION of the library. */
+CHIP8_ENV_API uint32_t chip8_env_version(void);
+
+/* NULL when the config is invalid or the environments can't be allocated. */
+CHIP8_ENV_API chip8_env *chip8_env_create(const chip8_env_config *config);
+
+CHIP8_ENV_API void chip8_env_destroy(chip8_env *env);
+
+CHIP8_ENV_API uint32_t chip8_env_count(const chip8_env *env);
+
+/* bytes of observation per environment. */
+CHIP8_ENV_API size_t chip8_env_observation_size(const chip8_env *env);
+
+/* restart the environments whose mask byte is not 0, all of them when mask
+ * is NULL, seeded from seeds[i] or as at creation when seeds is NULL.
+ * then writes the observations and probes of every environment, into
+ * count * chip8_env_observation_size and count * probe_count bytes;
+ * either may be NULL. 0, or -1 when it failed. */
+CHIP8_ENV_API int chip8_env_reset(chip8_env *env, const uint8_t *mask, const uint64_t *seeds,
+                                  void *observations, uint8_t *probes);
+
+/* one step of every environment. actions[i] is the keys held down by
+ * environment i during the step, bit k for key k. writes count
+ * observations, count * probe_count probes and count rewards; any of them
+ * may be NULL. 0, or -1 when it failed. */
+CHIP8_ENV_API int chip8_env_step_batch(chip8_env *env, const uint16_t *actions, void *observations,
+                                       uint8_t *probes, float *rewards);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHIP8ENV_H */
@@ -2,101 +2,103 @@
 
 #include<iostream>
 #include<fstream>
-#include<QDateTime>
-#include<QString>
+#include<iomanip>
+#include<algorithm>
+#include<cstring>
 
-#include "utils.h"
+#include "jit.h"
 
-Chip8Interpreter::Chip8Interpreter(QObject *parent) : QThread{parent} {
+Chip8Interpreter::Chip8Interpreter() {
     // copy fontset data
     for (int i = 0; i < 80; i++) {
         RAM[i] = CHIP8FONTSET[i];
     }
+#ifdef CHIP8_LEGACY_DISPATCH
     // fill function map
     functionMap = {
             {0x00, [this](std::shared_ptr<Instruction> ins) {
                 if (ins->KK == 0xE0) {
-                    CLS(ins);
+                    CLS(*ins);
                 } else if (ins->KK == 0xEE) {
-                    RET(ins);
+                    RET(*ins);
                 }
             }},
             {0x01, [this](std::shared_ptr<Instruction> ins) {
-                JP_Addr(ins);
+                JP_Addr(*ins);
             }},
             {0x02, [this](std::shared_ptr<Instruction> ins) {
-                CALL_Addr(ins);
+                CALL_Addr(*ins);
             }},
             {0x03, [this](std::shared_ptr<Instruction> ins) {
-                SE_Vx_Byte(ins);
+                SE_Vx_Byte(*ins);
             }},
             {0x04, [this](std::shared_ptr<Instruction> ins) {
-                SNE_Vx_Byte(ins);
+                SNE_Vx_Byte(*ins);
             }},
             {0x05, [this](std::shared_ptr<Instruction> ins) {
-                SE_Vx_Vy(ins);
+                SE_Vx_Vy(*ins);
             }},
             {0x06, [this](std::shared_ptr<Instruction> ins) {
-                LD_Vx_Byte(ins);
+                LD_Vx_Byte(*ins);
             }},
             {0x07, [this](std::shared_ptr<Instruction> ins) {
-                ADD_Vx_Byte(ins);
+                ADD_Vx_Byte(*ins);
             }},
             {0x08, [this](std::shared_ptr<Instruction> ins) {
                 switch (ins->N) {
                     case 0x0:
-                        LD_Vx_Vy(ins);
+                        LD_Vx_Vy(*ins);
                         break;
                     case 0x1:
-                        OR_Vx_Vy(ins);
+                        OR_Vx_Vy(*ins);
                         break;
                     case 0x2:
-                        AND_Vx_Vy(ins);
+                        AND_Vx_Vy(*ins);
                         break;
                     case 0x3:
-                        XOR_Vx_Vy(ins);
+                        XOR_Vx_Vy(*ins);
                         break;
                     case 0x4:
-                        ADD_Vx_Vy(ins);
+                        ADD_Vx_Vy(*ins);
                         break;
                     case 0x5:
-                        SUB_Vx_Vy(ins);
+                        SUB_Vx_Vy(*ins);
                         break;
                     case 0x6:
-                        SHR_Vx_iVy(ins);
+                        SHR_Vx_iVy(*ins);
                         break;
                     case 0x7:
-                        SUBN_Vx_Vy(ins);
+                        SUBN_Vx_Vy(*ins);
                         break;
                     case 0xE:
-                        SHL_Vx_iVy(ins);
+                        SHL_Vx_iVy(*ins);
                         break;
                     default:
                         break;
                 }
             }},
             {0x09, [this](std::shared_ptr<Instruction> ins) {
-                SNE_Vx_Vy(ins);
+                SNE_Vx_Vy(*ins);
             }},
             {0x0A, [this](std::shared_ptr<Instruction> ins) {
-                LD_I_Addr(ins);
+                LD_I_Addr(*ins);
             }},
             {0x0B, [this](std::shared_ptr<Instruction> ins) {
-                JP_V0_Addr(ins);
+                JP_V0_Addr(*ins);
             }},
             {0x0C, [this](std::shared_ptr<Instruction> ins) {
-                RND_Vx_KK(ins);
+                RND_Vx_KK(*ins);
             }},
             {0x0D, [this](std::shared_ptr<Instruction> ins) {
-                DRW_Vx_Vy_N(ins);
+                DRW_Vx_Vy_N(*ins);
             }},
             {0x0E, [this](std::shared_ptr<Instruction> ins) {
                 switch (ins->KK) {
                     case 0x9E:
-                        SKP_Vx(ins);
+                        SKP_Vx(*ins);
                         break;
                     case 0xA1:
-                        SKNP_Vx(ins);
+                        SKNP_Vx(*ins);
                         break;
                     default:
                         break;
@@ -105,227 +107,670 @@ Chip8Interpreter::Chip8Interpreter(QObject *parent) : QThread{parent} {
             {0x0F, [this](std::shared_ptr<Instruction> ins) {
                 switch (ins->KK) {
                     case 0x07:
-                        LD_Vx_DT(ins);
+                        LD_Vx_DT(*ins);
                         break;
                     case 0x0A:
-                        LD_Vx_K(ins);
+                        LD_Vx_K(*ins);
                         break;
                     case 0x15:
-                        LD_DT_Vx(ins);
+                        LD_DT_Vx(*ins);
                         break;
                     case 0x18:
-                        LD_ST_Vx(ins);
+                        LD_ST_Vx(*ins);
                         break;
                     case 0x1E:
-                        ADD_I_Vx(ins);
+                        ADD_I_Vx(*ins);
                         break;
                     case 0x29:
-                        LD_F_Vx(ins);
+                        LD_F_Vx(*ins);
                         break;
                     case 0x33:
-                        LD_B_Vx(ins);
+                        LD_B_Vx(*ins);
                         break;
                     case 0x55:
-                        LD_I_Vx(ins);
+                        LD_I_Vx(*ins);
                         break;
                     case 0x65:
-                        LD_Vx_I(ins);
+                        LD_Vx_I(*ins);
                         break;
                     default:
                         break;
                 }
             }},
     };
-
-    timer = new QTimer();
-    connect(timer, &QTimer::timeout, this, &Chip8Interpreter::Tick);
-    timer->setInterval(tickInterval);
-    timer->start();
+#endif
 }
 
-void Chip8Interpreter::run() {
-    exec();
-}
+Chip8Interpreter::~Chip8Interpreter() = default;
 
 bool Chip8Interpreter::Load(const std::string &file) {
     std::ifstream stream(file, std::ios::binary | std::ios::in);
     if (!stream.is_open()) {
         return false;
     }
+    std::vector<uint8_t> rom;
     char c;
-    for (int i = 0x200; stream.get(c); i++) {
-        RAM[i] = c;
+    while (rom.size() < RAM.size() - 0x200 && stream.get(c)) {
+        rom.push_back(c);
     }
     stream.close();
+    Load(rom.data(), rom.size());
+    return true;
+}
+
+void Chip8Interpreter::Load(const uint8_t *rom, size_t size) {
+    size = std::min(size, RAM.size() - 0x200);
+    std::memcpy(&RAM[0x200], rom, size);
+    InvalidateCode(0x200, size);
+    if (hashing) {
+        memoryHash = HashMemory();
+    }
+
+    aotBlocks.fill(nullptr);
+    const AotProgram *program = FindAotProgram(&RAM[0x200], size);
+    if (program != nullptr) {
+        for (size_t b = 0; b < program->blockCount; b++) {
+            const AotBlock &block = program->blocks[b];
+            aotBlocks[block.start] = &block;
+            for (int address = block.start; address < block.end; address++) {
+                blockCode[address] = true;
+            }
+        }
+    }
     PC = 0x200;
     I = 0x200;
+}
+
+void Chip8Interpreter::Seed(uint64_t seed) {
+    RND = RNDRegister(seed);
+}
+
+static_assert(std::is_trivially_copyable<Chip8State>::value, "snapshots copy Chip8State as raw bytes");
+
+void Chip8Interpreter::SaveState(Chip8Snapshot &snapshot) const {
+    snapshot.header = Chip8Snapshot::magic;
+    snapshot.headerVersion = Chip8Snapshot::version;
+    std::memcpy(&snapshot.state, static_cast<const Chip8State *>(this), sizeof(Chip8State));
+}
+
+bool Chip8Interpreter::LoadState(const Chip8Snapshot &snapshot) {
+    if (snapshot.header != Chip8Snapshot::magic || snapshot.headerVersion != Chip8Snapshot::version) {
+        return false;
+    }
+
+    // only the parts of RAM that differ can invalidate decoded code.
+    const size_t chunk = 64;
+    for (size_t address = 0; address < RAM.size(); address += chunk) {
+        if (std::memcmp(&RAM[address], &snapshot.state.RAM[address], chunk) != 0) {
+            InvalidateCode(address, chunk);
+        }
+    }
+    std::memcpy(static_cast<Chip8State *>(this), &snapshot.state, sizeof(Chip8State));
+
+    drawFlag = true;
+    dirtyRows = 0xFFFFFFFF;
+    if (hashing) {
+        memoryHash = HashMemory();
+    }
     return true;
 }
 
-std::shared_ptr<Instruction> Chip8Interpreter::ParseInstruction(uint16_t opcode) {
-    std::shared_ptr<Instruction> ins = std::make_shared<Instruction>();
-    ins->NNN = opcode & 0x0FFF;
-    ins->KK = opcode & 0x00FF;
-    ins->X = (opcode & 0x0F00) >> 8;
-    ins->Y = (opcode & 0x00F0) >> 4;
-    ins->N = opcode & 0x000F;
+bool Chip8Interpreter::LoadState(const Chip8Snapshot &snapshot, uint64_t hash) {
+    bool wasHashing = hashing;
+    hashing = false;
+    bool loaded = LoadState(snapshot);
+    hashing = wasHashing;
+    if (loaded) {
+        memoryHash = hash;
+    }
+    return loaded;
+}
+
+// positions of the memory hash terms.
+const static uint32_t stackPosition{0x1000};
+const static uint32_t bufferPosition{stackPosition + Chip8State::stackSize};
+
+// the term of value at position: a random word per (position, value) as in
+// Zobrist hashing, computed by splitmix64 rather than kept in a table.
+static inline uint64_t Zobrist(uint32_t position, uint64_t value) {
+    uint64_t z = value * 0x9E3779B97F4A7C15 + position * 0xD6E8FEB86659FD93 + 0x632BE59BD9B4E019;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+}
 
-    return ins;
+void Chip8Interpreter::StartHashing() {
+    memoryHash = HashMemory();
+    hashing = true;
 }
 
-void Chip8Interpreter::Tick() {
+uint64_t Chip8Interpreter::HashMemory() const {
+    uint64_t hash = 0;
+    for (uint32_t address = 0; address < RAM.size(); address++) {
+        hash ^= Zobrist(address, RAM[address]);
+    }
+    for (uint32_t i = 0; i < STACK.size(); i++) {
+        hash ^= Zobrist(stackPosition + i, STACK[i]);
+    }
+    for (uint32_t row = 0; row < BUFFER.size(); row++) {
+        hash ^= Zobrist(bufferPosition + row, BUFFER[row]);
+    }
+    return hash;
+}
+
+uint64_t Chip8Interpreter::IncrementalHash() const {
+    uint64_t v[2];
+    std::memcpy(v, V.data(), sizeof(v));
+    uint64_t hash = memoryHash;
+    hash = Zobrist(0x10000, hash ^ v[0]);
+    hash = Zobrist(0x10001, hash ^ v[1]);
+    hash = Zobrist(0x10002, hash ^ (DT | ST << 8 | SP << 16 | (uint64_t) I << 24 | (uint64_t) PC << 40));
+    hash = Zobrist(0x10003, hash ^ INPUTS);
+    return Zobrist(0x10004, hash ^ RND.state);
+}
+bool Chip8Interpreter::SaveStateFile(const std::string &file) const {
+    std::ofstream stream(file, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!stream.is_open()) {
+        return false;
+    }
+    auto snapshot = std::make_unique<Chip8Snapshot>();
+    SaveState(*snapshot);
+    stream.write(reinterpret_cast<const char *>(snapshot.get()), sizeof(Chip8Snapshot));
+    return stream.good();
+}
+
+bool Chip8Interpreter::LoadStateFile(const std::string &file) {
+    std::ifstream stream(file, std::ios::binary | std::ios::in);
+    if (!stream.is_open()) {
+        return false;
+    }
+    auto snapshot = std::make_unique<Chip8Snapshot>();
+    if (!stream.read(reinterpret_cast<char *>(snapshot.get()), sizeof(Chip8Snapshot))) {
+        return false;
+    }
+    return LoadState(*snapshot);
+}
+
+const std::array<Chip8Interpreter::Handler, (size_t) Op::COUNT> Chip8Interpreter::handlers = {
+        &Chip8Interpreter::UNKNOWN,
+        &Chip8Interpreter::CLS,
+        &Chip8Interpreter::RET,
+        &Chip8Interpreter::JP_Addr,
+        &Chip8Interpreter::CALL_Addr,
+        &Chip8Interpreter::SE_Vx_Byte,
+        &Chip8Interpreter::SNE_Vx_Byte,
+        &Chip8Interpreter::SE_Vx_Vy,
+        &Chip8Interpreter::LD_Vx_Byte,
+        &Chip8Interpreter::ADD_Vx_Byte,
+        &Chip8Interpreter::LD_Vx_Vy,
+        &Chip8Interpreter::OR_Vx_Vy,
+        &Chip8Interpreter::AND_Vx_Vy,
+        &Chip8Interpreter::XOR_Vx_Vy,
+        &Chip8Interpreter::ADD_Vx_Vy,
+        &Chip8Interpreter::SUB_Vx_Vy,
+        &Chip8Interpreter::SHR_Vx_iVy,
+        &Chip8Interpreter::SUBN_Vx_Vy,
+        &Chip8Interpreter::SHL_Vx_iVy,
+        &Chip8Interpreter::SNE_Vx_Vy,
+        &Chip8Interpreter::LD_I_Addr,
+        &Chip8Interpreter::JP_V0_Addr,
+        &Chip8Interpreter::RND_Vx_KK,
+        &Chip8Interpreter::DRW_Vx_Vy_N,
+        &Chip8Interpreter::SKP_Vx,
+        &Chip8Interpreter::SKNP_Vx,
+        &Chip8Interpreter::LD_Vx_DT,
+        &Chip8Interpreter::LD_Vx_K,
+        &Chip8Interpreter::LD_DT_Vx,
+        &Chip8Interpreter::LD_ST_Vx,
+        &Chip8Interpreter::ADD_I_Vx,
+        &Chip8Interpreter::LD_F_Vx,
+        &Chip8Interpreter::LD_B_Vx,
+        &Chip8Interpreter::LD_I_Vx,
+        &Chip8Interpreter::LD_Vx_I,
+};
+
+void Chip8Interpreter::StartTrace(size_t records) {
+    if (!traceRing || traceRing->Capacity() < records) {
+        traceRing = std::make_unique<TraceRing>(records);
+    }
+    tracing = true;
+}
+
+void Chip8Interpreter::StopTrace() {
+    tracing = false;
+}
+
+const TraceRing *Chip8Interpreter::Trace() const {
+    return traceRing.get();
+}
+
+const Chip8Interpreter::DecodedInstruction &Chip8Interpreter::DecodeAt(uint16_t address) {
+    address &= 0x0FFF;
+    DecodedInstruction &entry = decodeCache[address];
+    if (entry.handler != nullptr) {
+        decodeCacheStats.hits++;
+        return entry;
+    }
+    decodeCacheStats.misses++;
+
     // read 2 bytes opcode (big endian).
-    uint16_t opcode = RAM[PC] << 8 | RAM[PC + 1];
+    uint16_t opcode = RAM[address] << 8 | RAM[(address + 1) & 0x0FFF];
+    entry.ins = ParseInstruction(opcode);
+    entry.handler = handlers[(size_t) Decode(opcode)];
+    return entry;
+}
+
+void Chip8Interpreter::InvalidateCode(uint16_t address, uint16_t length) {
+    // stores wrap around at the end of RAM, as addresses do.
+    address &= 0x0FFF;
+    if (address + length > (int) RAM.size()) {
+        InvalidateCode(0, address + length - RAM.size());
+        length = RAM.size() - address;
+    }
+    // the instruction starting one byte before address overlaps it as well,
+    // the last one of RAM overlaps address 0.
+    if (address == 0 && decodeCache[0x0FFF].handler != nullptr) {
+        decodeCache[0x0FFF].handler = nullptr;
+        decodeCacheStats.invalidations++;
+    }
+    int begin = address > 0 ? address - 1 : 0;
+    int end = std::min<int>(address + length, decodeCache.size());
+    for (int i = begin; i < end; i++) {
+        if (decodeCache[i].handler != nullptr) {
+            decodeCache[i].handler = nullptr;
+            decodeCacheStats.invalidations++;
+        }
+    }
 
-//    std::cout << QString("PC: %1, opcode: %2").arg(ToHex(PC), ToHex(opcode)).toStdString() << std::endl;
+    // writes outside translated code don't touch the block cache.
+    bool hitsBlock = false;
+    for (int i = address; i < end; i++) {
+        if (blockCode[i]) {
+            hitsBlock = true;
+            break;
+        }
+    }
+    if (!hitsBlock) {
+        return;
+    }
+    for (auto &block: blockCache) {
+        if (block && block->start < end && block->end > address) {
+            block.reset();
+            blockCacheStats.invalidations++;
+        }
+    }
+    for (auto &block: aotBlocks) {
+        if (block && block->start < end && block->end > address) {
+            block = nullptr;
+        }
+    }
+    for (int i = address; i < end; i++) {
+        blockCode[i] = false;
+    }
+}
 
-    auto ins = ParseInstruction(opcode);
+void Chip8Interpreter::ExecuteInstruction() {
+#ifdef CHIP8_LEGACY_DISPATCH
+    // read 2 bytes opcode (big endian).
+    uint16_t opcode = RAM[PC & 0x0FFF] << 8 | RAM[(PC + 1) & 0x0FFF];
+
+    auto ins = std::make_shared<Instruction>(ParseInstruction(opcode));
     int op = opcode >> 12;
+    uint16_t pc = PC;
     if (functionMap.find(op) != functionMap.end()) {
         functionMap[op](ins);
     }
+#else
+    const DecodedInstruction &entry = DecodeAt(PC);
+#ifdef CHIP8_PROFILE
+    profile.Count(Decode(entry.ins.opcode), entry.ins.opcode, PC);
+#endif
+    // a store may drop the entry, see ExecuteBlock.
+    Instruction ins = entry.ins;
+    uint16_t pc = PC;
+    (this->*entry.handler)(ins);
+    uint16_t opcode = ins.opcode;
+#endif
+    if (tracing) {
+        traceRing->Add(pc, opcode, I, V[(opcode >> 8) & 0x0F], V[0x0F]);
+    }
+}
+
+std::unique_ptr<Chip8Interpreter::Block> Chip8Interpreter::TranslateBlock(uint16_t address) {
+    auto block = std::make_unique<Block>();
+    block->start = address & 0x0FFF;
+    uint16_t pc = block->start;
+    while (pc + 1u < RAM.size()) {
+        const DecodedInstruction &entry = DecodeAt(pc);
+        block->code.push_back(entry);
+        pc += 2;
+        if (IsBlockTerminator(Decode(entry.ins.opcode))) {
+            break;
+        }
+    }
+    block->end = pc;
+    for (int i = block->start; i < block->end; i++) {
+        blockCode[i] = true;
+    }
+    blockCacheStats.translations++;
+    return block;
+}
+
+void Chip8Interpreter::CompileBlock(Block &block) {
+    if (!jit) {
+        jit = std::make_unique<Jit>(*this);
+    }
+    block.native = jit->Compile(block);
+    if (block.native == nullptr) {
+        // code buffer is full, start over.
+        jit->Flush();
+        for (auto &b: blockCache) {
+            if (b) {
+                b->native = nullptr;
+            }
+        }
+        block.native = jit->Compile(block);
+    }
+}
 
-    uint64_t currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch();
-    if (currentTime - time > 20) {
-        if (DT > 0) {
-            DT--;
+uint32_t Chip8Interpreter::ExecuteBlock(uint32_t budget) {
+    std::unique_ptr<Block> &block = blockCache[PC & 0x0FFF];
+#if defined(CHIP8_JIT_AVAILABLE) && !defined(CHIP8_PROFILE)
+    // compiled blocks first, with as few checks as possible: most blocks
+    // are a handful of instructions, the checks would cost as much as them.
+    if (block && block->native != nullptr && !tracing) {
+        uint32_t count = block->code.size();
+        if (count <= budget) {
+            block->native(this);
+            return count;
+        }
+    }
+#endif
+    if (!block) {
+        block = TranslateBlock(PC);
+    }
+    if (block->code.empty() || block->code.size() > budget) {
+        // nothing to translate at the very end of RAM, or the budget ends inside the block.
+        ExecuteInstruction();
+        return 1;
+    }
+#if defined(CHIP8_JIT_AVAILABLE) && !defined(CHIP8_PROFILE)
+    if (engine == Engine::Jit && !tracing) {
+        if (block->native == nullptr && ++block->hits == jitThreshold) {
+            CompileBlock(*block);
         }
-        if (ST > 0) {
-            emit beep(ST * 20);
-            ST = 0;
+        if (block->native != nullptr) {
+            uint32_t count = block->code.size();
+            block->native(this);
+            return count;
+        }
+    }
+#endif
+
+    // a store at the end of the block may drop the block itself,
+    // so nothing is read from it after the last handler returns.
+    // tracing doesn't change inside a block, so it is tested once.
+    const DecodedInstruction *code = block->code.data();
+    uint32_t count = block->code.size();
+    if (tracing) {
+        for (uint32_t i = 0; i < count; i++) {
+#ifdef CHIP8_PROFILE
+            profile.Count(Decode(code[i].ins.opcode), code[i].ins.opcode, PC);
+#endif
+            uint16_t opcode = code[i].ins.opcode;
+            uint16_t pc = PC;
+            (this->*code[i].handler)(code[i].ins);
+            traceRing->Add(pc, opcode, I, V[(opcode >> 8) & 0x0F], V[0x0F]);
+        }
+        return count;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+#ifdef CHIP8_PROFILE
+        profile.Count(Decode(code[i].ins.opcode), code[i].ins.opcode, PC);
+#endif
+        (this->*code[i].handler)(code[i].ins);
+    }
+    return count;
+}
+
+uint32_t Chip8Interpreter::ExecuteAot(uint32_t budget) {
+#ifdef CHIP8_PROFILE
+    const AotBlock *block = nullptr;
+#else
+    const AotBlock *block = aotBlocks[PC & 0x0FFF];
+#endif
+    if (block == nullptr || tracing || (uint32_t) (block->end - block->start) / 2 > budget) {
+        ExecuteInstruction();
+        return 1;
+    }
+    return block->function(*this);
+}
+
+// the keys and the timers only change between Step calls. so when control
+// comes back to an address with the registers unchanged and nothing stored,
+// the code in between repeats itself exactly until the end of cycles: those
+// iterations are skipped, the last partial one runs, and the machine ends up
+// as if every instruction had run. addresses reached by a backward (or no)
+// jump are watched, that is where loops close.
+uint64_t Chip8Interpreter::Step(uint64_t cycles) {
+    uint64_t executed = 0;
+    IdleWatch watch;
+    bool watching = false;
+    while (executed < cycles) {
+        uint16_t previousPC = PC;
+        uint32_t budget = std::min<uint64_t>(cycles - executed, UINT32_MAX);
+        switch (engine) {
+            case Engine::Block:
+            case Engine::Jit:
+                executed += ExecuteBlock(budget);
+                break;
+            case Engine::Aot:
+                executed += ExecuteAot(budget);
+                break;
+            default:
+                ExecuteInstruction();
+                executed++;
+                break;
+        }
+
+        if (!skipIdle) {
+            continue;
         }
-        if (drawFlag) {
-            emit draw(BUFFER);
-            drawFlag = false;
+        if (watching && PC == watch.PC && Unchanged(watch)) {
+            uint64_t length = executed - watch.executed;
+            uint64_t idle = (cycles - executed) / length * length;
+            executed += idle;
+            idleInstructionCount += idle;
+#ifdef CHIP8_PROFILE
+            profile.idleInstructions += idle;
+#endif
+            watching = false;
+        } else if (PC <= previousPC) {
+            Watch(watch, executed);
+            watching = true;
         }
-        time = currentTime;
+    }
+    instructionCount += executed;
+    return executed;
+}
+
+void Chip8Interpreter::Watch(IdleWatch &watch, uint64_t executed) const {
+    watch.PC = PC;
+    watch.executed = executed;
+    watch.stores = storeCount;
+    watch.V = V;
+    watch.I = I;
+    watch.SP = SP;
+    watch.DT = DT;
+    watch.ST = ST;
+    watch.RND = RND.state;
+}
+
+bool Chip8Interpreter::Unchanged(const IdleWatch &watch) const {
+    return watch.stores == storeCount && watch.V == V && watch.I == I && watch.SP == SP &&
+           watch.DT == DT && watch.ST == ST && watch.RND == RND.state;
+}
+
+void Chip8Interpreter::RunFrame() {
+#ifdef CHIP8_PROFILE
+    Profile::Scope scope(profile.frame);
+#endif
+    Step(cyclesPerFrame);
+    TickTimers();
+    frameCount++;
+}
+
+void Chip8Interpreter::TickTimers() {
+    if (DT > 0) {
+        DT--;
+    }
+    if (ST > 0) {
+        beepMilliseconds = ST * 1000 / frameRate;
+        ST = 0;
     }
 }
 
 void Chip8Interpreter::Push(uint16_t opcode) {
-    // std::cout << QString("Push: %1").arg(ToHex(opcode)).toStdString() << std::endl;
+    if (hashing) {
+        memoryHash ^= Zobrist(stackPosition + SP, STACK[SP]) ^ Zobrist(stackPosition + SP, opcode);
+    }
     STACK[SP++] = opcode;
+    storeCount++;
+}
+
+void Chip8Interpreter::Store(uint16_t address, uint8_t value) {
+    address &= 0x0FFF;
+    if (hashing) {
+        memoryHash ^= Zobrist(address, RAM[address]) ^ Zobrist(address, value);
+    }
+    RAM[address] = value;
 }
 
 uint16_t Chip8Interpreter::Pop() {
     uint16_t opcode = STACK[--SP];
-    // std::cout << QString("Pop: %1").arg(ToHex(opcode)).toStdString() << std::endl;
     return opcode;
 }
 
 void Chip8Interpreter::KeyDown(int key) {
-    INPUTS[key] = true;
+    INPUTS |= 1 << key;
 }
 
 void Chip8Interpreter::KeyUp(int key) {
-    INPUTS[key] = false;
+    INPUTS &= ~(1 << key);
+}
+
+// unknown opcodes (and 0nnn SYS) are ignored, PC is left untouched.
+void Chip8Interpreter::UNKNOWN(Instruction) {
 }
 
-void Chip8Interpreter::CLS(std::shared_ptr<Instruction> ins) {
-    for (int x = 0; x < screenHeight; x++) {
-        for (int y = 0; y < screenWidth; y++) {
-            BUFFER[x][y] = false;
+void Chip8Interpreter::CLS(Instruction) {
+    if (hashing) {
+        for (uint32_t row = 0; row < BUFFER.size(); row++) {
+            memoryHash ^= Zobrist(bufferPosition + row, BUFFER[row]) ^ Zobrist(bufferPosition + row, 0);
         }
     }
+    BUFFER.fill(0);
+    storeCount++;
+    drawFlag = true;
+    dirtyRows = 0xFFFFFFFF;
     PC += 2;
 }
 
-void Chip8Interpreter::RET(std::shared_ptr<Instruction> ins) {
+void Chip8Interpreter::RET(Instruction) {
     PC = Pop();
     PC += 2;
 }
 
 
-void Chip8Interpreter::JP_Addr(std::shared_ptr<Instruction> ins) {
-    PC = ins->NNN;
+void Chip8Interpreter::JP_Addr(Instruction ins) {
+    PC = ins.NNN;
 }
 
-void Chip8Interpreter::CALL_Addr(std::shared_ptr<Instruction> ins) {
-    std::cout << QString("Call Address: %1").arg(ToHex(ins->NNN)).toStdString() << std::endl;
+void Chip8Interpreter::CALL_Addr(Instruction ins) {
     Push(PC);
-    PC = ins->NNN;
+    PC = ins.NNN;
 }
 
-void Chip8Interpreter::SE_Vx_Byte(std::shared_ptr<Instruction> ins) {
-    if (V[ins->X] == ins->KK) {
+void Chip8Interpreter::SE_Vx_Byte(Instruction ins) {
+    if (V[ins.X] == ins.KK) {
         PC += 2;
     }
     PC += 2;
 }
 
-void Chip8Interpreter::SNE_Vx_Byte(std::shared_ptr<Instruction> ins) {
-    if (V[ins->X] != ins->KK) {
+void Chip8Interpreter::SNE_Vx_Byte(Instruction ins) {
+    if (V[ins.X] != ins.KK) {
         PC += 2;
     }
     PC += 2;
 }
 
-void Chip8Interpreter::SE_Vx_Vy(std::shared_ptr<Instruction> ins) {
-    if (V[ins->X] == V[ins->Y]) {
+void Chip8Interpreter::SE_Vx_Vy(Instruction ins) {
+    if (V[ins.X] == V[ins.Y]) {
         PC += 2;
     }
     PC += 2;
 }
 
-void Chip8Interpreter::LD_Vx_Byte(std::shared_ptr<Instruction> ins) {
-    V[ins->X] = ins->KK;
+void Chip8Interpreter::LD_Vx_Byte(Instruction ins) {
+    V[ins.X] = ins.KK;
     PC += 2;
 }
 
-void Chip8Interpreter::ADD_Vx_Byte(std::shared_ptr<Instruction> ins) {
-    V[ins->X] += ins->KK;
+void Chip8Interpreter::ADD_Vx_Byte(Instruction ins) {
+    V[ins.X] += ins.KK;
     PC += 2;
 }
 
-void Chip8Interpreter::LD_Vx_Vy(std::shared_ptr<Instruction> ins) {
+void Chip8Interpreter::LD_Vx_Vy(Instruction ins) {
 
-    V[ins->X] = V[ins->Y];
+    V[ins.X] = V[ins.Y];
     PC += 2;
 }
 
-void Chip8Interpreter::OR_Vx_Vy(std::shared_ptr<Instruction> ins) {
-    V[ins->X] |= V[ins->Y];
+void Chip8Interpreter::OR_Vx_Vy(Instruction ins) {
+    V[ins.X] |= V[ins.Y];
     V[0x0F] = 0;
     PC += 2;
 }
 
-void Chip8Interpreter::AND_Vx_Vy(std::shared_ptr<Instruction> ins) {
-    V[ins->X] &= V[ins->Y];
+void Chip8Interpreter::AND_Vx_Vy(Instruction ins) {
+    V[ins.X] &= V[ins.Y];
     V[0x0F] = 0;
     PC += 2;
 }
 
-void Chip8Interpreter::XOR_Vx_Vy(std::shared_ptr<Instruction> ins) {
-    V[ins->X] ^= V[ins->Y];
+void Chip8Interpreter::XOR_Vx_Vy(Instruction ins) {
+    V[ins.X] ^= V[ins.Y];
     V[0x0F] = 0;
     PC += 2;
 }
 
-void Chip8Interpreter::ADD_Vx_Vy(std::shared_ptr<Instruction> ins) {
-    if (V[ins->X] > 0xFF - V[ins->Y]) {
+void Chip8Interpreter::ADD_Vx_Vy(Instruction ins) {
+    if (V[ins.X] > 0xFF - V[ins.Y]) {
         V[0x0F] = 1;
     } else {
         V[0x0F] = 0;
     }
 
-    V[ins->X] += V[ins->Y];
+    V[ins.X] += V[ins.Y];
     PC += 2;
 }
 
-void Chip8Interpreter::SUB_Vx_Vy(std::shared_ptr<Instruction> ins) {
-    if (V[ins->X] < V[ins->Y]) {
+void Chip8Interpreter::SUB_Vx_Vy(Instruction ins) {
+    if (V[ins.X] < V[ins.Y]) {
         V[0x0F] = 0;
     } else {
         V[0x0F] = 1;
     }
 
-    V[ins->X] -= V[ins->Y];
+    V[ins.X] -= V[ins.Y];
     PC += 2;
 }
 
-void Chip8Interpreter::SHR_Vx_iVy(std::shared_ptr<Instruction> ins) {
-    V[0x0F] = V[ins->X] & 0x01;
-    V[ins->X] >>= 1;
+void Chip8Interpreter::SHR_Vx_iVy(Instruction ins) {
+    V[0x0F] = V[ins.X] & 0x01;
+    V[ins.X] >>= 1;
     PC += 2;
 }
 
@@ -333,15 +778,15 @@ void Chip8Interpreter::SHR_Vx_iVy(std::shared_ptr<Instruction> ins) {
 // set Vx = Vy - Vx, set VF = NOT borrow.
 // if Vy > Vx, then VF is set to 1, otherwise 0.
 // then Vx is subtracted from Vy, and the results stored in Vx.
-void Chip8Interpreter::SUBN_Vx_Vy(std::shared_ptr<Instruction> ins) {
+void Chip8Interpreter::SUBN_Vx_Vy(Instruction ins) {
 
-    if (V[ins->X] > V[ins->Y]) {
+    if (V[ins.X] > V[ins.Y]) {
         V[0x0F] = 0;
     } else {
         V[0x0F] = 1;
     }
 
-    V[ins->X] = V[ins->Y] - V[ins->X];
+    V[ins.X] = V[ins.Y] - V[ins.X];
     PC += 2;
 }
 
@@ -349,17 +794,17 @@ void Chip8Interpreter::SUBN_Vx_Vy(std::shared_ptr<Instruction> ins) {
 // set Vx = Vx SHL 1.
 // if the most-significant bit of Vx is 1, then VF is set to 1, otherwise to 0.
 // then Vx is multiplied by 2.
-void Chip8Interpreter::SHL_Vx_iVy(std::shared_ptr<Instruction> ins) {
-    V[0x0F] = V[ins->X] >> 7;
-    V[ins->X] <<= 1;
+void Chip8Interpreter::SHL_Vx_iVy(Instruction ins) {
+    V[0x0F] = V[ins.X] >> 7;
+    V[ins.X] <<= 1;
     PC += 2;
 }
 
 // 9xy0
 // skip next instruction if Vx != Vy.
 // the values of Vx and Vy are compared, and if they are not equal, the program counter is increased by 2.
-void Chip8Interpreter::SNE_Vx_Vy(std::shared_ptr<Instruction> ins) {
-    if (V[ins->X] != V[ins->Y]) {
+void Chip8Interpreter::SNE_Vx_Vy(Instruction ins) {
+    if (V[ins.X] != V[ins.Y]) {
         PC += 2;
     }
     PC += 2;
@@ -368,24 +813,24 @@ void Chip8Interpreter::SNE_Vx_Vy(std::shared_ptr<Instruction> ins) {
 // Annn
 // set I = nnn.
 // the value of register I is set to nnn.
-void Chip8Interpreter::LD_I_Addr(std::shared_ptr<Instruction> ins) {
-    I = ins->NNN;
+void Chip8Interpreter::LD_I_Addr(Instruction ins) {
+    I = ins.NNN;
     PC += 2;
 }
 
 // Bnnn
 // jump to location nnn + V0.
 // the program counter is set to nnn plus the value of V0.
-void Chip8Interpreter::JP_V0_Addr(std::shared_ptr<Instruction> ins) {
-    PC = (uint16_t) V[0] + ins->NNN;
+void Chip8Interpreter::JP_V0_Addr(Instruction ins) {
+    PC = (uint16_t) V[0] + ins.NNN;
 }
 
 // Cxkk
 // set Vx = random byte AND kk.
 // the interpreter generates a random number from 0 to 255, which is then ANDed with the value kk.
 // the results are stored in Vx.
-void Chip8Interpreter::RND_Vx_KK(std::shared_ptr<Instruction> ins) {
-    V[ins->X] = RND.next() & ins->KK;
+void Chip8Interpreter::RND_Vx_KK(Instruction ins) {
+    V[ins.X] = RND.next() & ins.KK;
     PC += 2;
 }
 
@@ -394,140 +839,125 @@ void Chip8Interpreter::RND_Vx_KK(std::shared_ptr<Instruction> ins) {
 // Each row of 8 pixels is read as bit-coded starting from memory location I;
 // I value doesn’t change after the execution of this instruction.
 // VF is set to 1 if any screen pixels are flipped from set to unset when the sprite is drawn, and to 0 if that doesn’t happen
-void Chip8Interpreter::DRW_Vx_Vy_N(std::shared_ptr<Instruction> ins) {
-    // std::cout << "draw instruction called." << std::endl;
-    // for(int i = 0; i < screenHeight; i++) {
-    //     for (int j = 0; j < screenWidth; j++) {
-    //         std::cout << BUFFER[i][j] << " ";
-    //     }
-    //     std::cout << std::endl;
-    // }
-    // std::cout << std::endl;
-
-
-    int startX = V[ins->X];
-    int startY = V[ins->Y];
-
+void Chip8Interpreter::DRW_Vx_Vy_N(Instruction ins) {
+#ifdef CHIP8_PROFILE
+    Profile::Scope scope(profile.draw);
+#endif
+    int startX = V[ins.X] % screenWidth;
+    int startY = V[ins.Y];
+    storeCount++;
 
     V[0x0F] = 0;
 
     // number of sprites for display
-    for (int i = 0; i < ins->N; i++) {
-        uint8_t spriteLine = RAM[I + i];
-        // fixed 1 byte for each sprite
-        for (int j = 0; j < 8; j++) {
-            int x = (startY + i) % screenHeight;
-            int y = (startX + j) % screenWidth;
-
-            bool currentPix = BUFFER[x][y];
-            bool spritePix = spriteLine & (0x80 >> j);
-
-            if (currentPix != spritePix) {
-                drawFlag = true;
-            }
-
-            if (currentPix && spritePix) {
-                V[0xF] = 1;
-            }
+    for (int i = 0; i < ins.N; i++) {
+        // fixed 1 byte for each sprite, rotated into place so it wraps around the right edge.
+        uint64_t spriteLine = (uint64_t) RAM[(I + i) & 0x0FFF] << 56;
+        if (startX != 0) {
+            spriteLine = spriteLine >> startX | spriteLine << (64 - startX);
+        }
+        if (spriteLine == 0) {
+            continue;
+        }
 
-            BUFFER[x][y] = (bool) (currentPix ^ spritePix);
+        int row = (startY + i) % screenHeight;
+        uint64_t &line = BUFFER[row];
+        if (line & spriteLine) {
+            V[0xF] = 1;
         }
+        if (hashing) {
+            memoryHash ^= Zobrist(bufferPosition + row, line) ^ Zobrist(bufferPosition + row, line ^ spriteLine);
+        }
+        line ^= spriteLine;
+        drawFlag = true;
+        dirtyRows |= 1u << row;
     }
 
     PC += 2;
-
-    // std::cout << "draw instruction called." << std::endl;
-    // for(int i = 0; i < screenHeight; i++) {
-    //     for (int j = 0; j < screenWidth; j++) {
-    //         std::cout << BUFFER[i][j] << " ";
-    //     }
-    //     std::cout << std::endl;
-    // }
-    // std::cout << std::endl;
-    // std::cout << "--------------" << std::endl;
 }
 
-void Chip8Interpreter::SKP_Vx(std::shared_ptr<Instruction> ins) {
-    if (INPUTS[V[ins->X]]) {
+void Chip8Interpreter::SKP_Vx(Instruction ins) {
+    if (INPUTS >> (V[ins.X] & 0xF) & 1) {
         PC += 2;
     }
     PC += 2;
 }
 
-void Chip8Interpreter::SKNP_Vx(std::shared_ptr<Instruction> ins) {
-    if (!INPUTS[V[ins->X]]) {
+void Chip8Interpreter::SKNP_Vx(Instruction ins) {
+    if (!(INPUTS >> (V[ins.X] & 0xF) & 1)) {
         PC += 2;
     }
     PC += 2;
 }
 
-void Chip8Interpreter::LD_Vx_DT(std::shared_ptr<Instruction> ins) {
-    V[ins->X] = DT;
+void Chip8Interpreter::LD_Vx_DT(Instruction ins) {
+    V[ins.X] = DT;
     PC += 2;
 }
 
 // Fx0A - LD Vx, K
 // wait for a key press, store the value of the key in Vx.
 // all execution stops until a key is pressed, then the value of that key is stored in Vx.
-void Chip8Interpreter::LD_Vx_K(std::shared_ptr<Instruction> ins) {
-    bool anyKeyPressed = false;
-
-    for (int i = 0; i < INPUTS.size(); i++) {
-        if (INPUTS[i]) {
-            anyKeyPressed = true;
-            V[ins->X] = i;
-            break;
-        }
+void Chip8Interpreter::LD_Vx_K(Instruction ins) {
+    if (INPUTS == 0) {
+        return;
     }
-
-    if (anyKeyPressed) {
-        PC += 2;
+    // the lowest key down.
+    int key = 0;
+    while (!(INPUTS >> key & 1)) {
+        key++;
     }
+    V[ins.X] = key;
+    PC += 2;
 }
 
-void Chip8Interpreter::LD_DT_Vx(std::shared_ptr<Instruction> ins) {
-    DT = V[ins->X];
+void Chip8Interpreter::LD_DT_Vx(Instruction ins) {
+    DT = V[ins.X];
     PC += 2;
 }
 
-void Chip8Interpreter::LD_ST_Vx(std::shared_ptr<Instruction> ins) {
-    ST = V[ins->X];
+void Chip8Interpreter::LD_ST_Vx(Instruction ins) {
+    ST = V[ins.X];
     PC += 2;
 }
 
-void Chip8Interpreter::ADD_I_Vx(std::shared_ptr<Instruction> ins) {
-    I += V[ins->X];
+void Chip8Interpreter::ADD_I_Vx(Instruction ins) {
+    I += V[ins.X];
     PC += 2;
 }
 
-void Chip8Interpreter::LD_F_Vx(std::shared_ptr<Instruction> ins) {
-    I = V[ins->X] * 0x5;
+void Chip8Interpreter::LD_F_Vx(Instruction ins) {
+    I = V[ins.X] * 0x5;
     PC += 2;
 }
 
-void Chip8Interpreter::LD_B_Vx(std::shared_ptr<Instruction> ins) {
-    int value = V[ins->X];
-    RAM[I] = value % 10;
+void Chip8Interpreter::LD_B_Vx(Instruction ins) {
+    int value = V[ins.X];
+    Store(I, value % 10);
     value /= 10;
-    RAM[I + 1] = value % 10;
+    Store(I + 1, value % 10);
     value /= 10;
-    RAM[I + 2] = value % 10;
+    Store(I + 2, value % 10);
+    storeCount++;
+    InvalidateCode(I, 3);
 
     PC += 2;
 }
 
-void Chip8Interpreter::LD_I_Vx(std::shared_ptr<Instruction> ins) {
-    for (int i = 0; i <= ins->X; i++) {
-        RAM[I + i] = V[i];
+void Chip8Interpreter::LD_I_Vx(Instruction ins) {
+    for (int i = 0; i <= ins.X; i++) {
+        Store(I + i, V[i]);
     }
-    I = I + ins->X + 1;
+    storeCount++;
+    InvalidateCode(I, ins.X + 1);
+    I = I + ins.X + 1;
     PC += 2;
 }
 
-void Chip8Interpreter::LD_Vx_I(std::shared_ptr<Instruction> ins) {
-    for (int i = 0; i <= ins->X; i++) {
-        V[i] = RAM[I + i];
+void Chip8Interpreter::LD_Vx_I(Instruction ins) {
+    for (int i = 0; i <= ins.X; i++) {
+        V[i] = RAM[(I + i) & 0x0FFF];
     }
-    I = I + ins->X + 1;
+    I = I + ins.X + 1;
     PC += 2;
 }
@@ -0,0 +1,420 @@
+#ifndef CHIP8INTERPRETER_H
+#define CHIP8INTERPRETER_H
+
+#include <string>
+#include <memory>
+#include <array>
+#include <map>
+#include <functional>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <bitset>
+#include <type_traits>
+
+#include "decoder.h"
+#include "aotprogram.h"
+#include "profile.h"
+#include "trace.h"
+
+const static uint8_t CHIP8FONTSET[80] =
+        {
+                0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+                0x20, 0x60, 0x20, 0x20, 0x70, // 1
+                0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+                0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+                0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+                0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+                0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+                0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+                0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+                0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+                0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+                0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+                0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+                0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+                0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+                0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+        };
+
+// xorshift64*, the state is a single word so it is saved with the machine.
+class RNDRegister {
+public:
+    uint64_t state;
+
+    RNDRegister() : RNDRegister(std::random_device{}()) {
+    }
+
+    explicit RNDRegister(uint64_t seed) {
+        // splitmix64 of the seed, never 0.
+        uint64_t z = seed + 0x9E3779B97F4A7C15;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        state = (z ^ (z >> 31)) | 1;
+    }
+
+    uint8_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (state * 0x2545F4914F6CDD1D) >> 56;
+    }
+};
+
+enum class Engine {
+    // one instruction per dispatch.
+    Interpreter,
+    // translated basic blocks, run as a chain of handlers.
+    Block,
+    // hot blocks recompiled to native code, blocks otherwise. translating
+    // and compiling cost more than they save on runs of a few frames.
+    Jit,
+    // blocks of a ROM compiled ahead of time by chip8-aot, interpreter otherwise.
+    Aot,
+};
+
+// the whole machine as plain data.
+struct Chip8State {
+    const static int screenWidth{64};
+    const static int screenHeight{32};
+    const static int stackSize{256};
+
+    // one bit per pixel, a uint64_t per row.
+    using Screen = std::array<uint64_t, screenHeight>;
+
+    // pixel at (row, column): bit 63 - column of the row, so a sprite byte
+    // shifted to the top of the word lands at column 0.
+    static bool Pixel(const Screen &screen, int row, int column) {
+        return screen[row] >> (63 - column) & 1;
+    }
+
+    // data registers
+    std::array<uint8_t, 16> V{};
+    // delay timer register
+    uint8_t DT{};
+    // sound timer register
+    uint8_t ST{};
+    // address register
+    uint16_t I{0x200};
+    // program counter
+    uint16_t PC{0x200};
+    // stack pointer
+    uint8_t SP{};
+    // stack
+    std::array<uint16_t, stackSize> STACK{};
+    // memory, 4KB
+    std::array<uint8_t, 0x1000> RAM{};
+    // keyboard inputs, bit k set while key k is down
+    uint16_t INPUTS{};
+    // screen buffer, see Pixel.
+    Screen BUFFER{};
+    // random
+    RNDRegister RND{};
+};
+
+// versioned copy of Chip8State, the same bytes in memory and in a file.
+struct Chip8Snapshot {
+    const static uint32_t magic{0x53533843}; // "C8SS"
+    const static uint32_t version{2};
+
+    uint32_t header{magic};
+    uint32_t headerVersion{version};
+    Chip8State state;
+};
+
+class Jit;
+
+// the CHIP-8 core, no dependency on Qt or on wall-clock time.
+// frontends call Step or RunFrame and present BUFFER when drawFlag is set.
+class Chip8Interpreter : public Chip8State {
+public:
+    // frames per second of the timers and the display.
+    const static int frameRate{60};
+
+    // instructions executed by RunFrame.
+    int cyclesPerFrame{10};
+    // executions before a block is compiled.
+    const static int jitThreshold{16};
+
+#ifdef CHIP8_LEGACY_DISPATCH
+    // function map
+    std::map<uint8_t, std::function<void(std::shared_ptr<Instruction>)>> functionMap;
+#endif
+
+    // instruction handler, Instruction is passed by value.
+    using Handler = void (Chip8Interpreter::*)(Instruction);
+
+    // Op -> handler, indexed by the result of Decode.
+    const static std::array<Handler, (size_t) Op::COUNT> handlers;
+
+    // instruction split into its fields, with the handler already resolved.
+    struct DecodedInstruction {
+        Instruction ins;
+        // nullptr until the address is decoded.
+        Handler handler;
+    };
+
+    struct DecodeCacheStats {
+        uint64_t hits;
+        uint64_t misses;
+        // cached entries dropped by writes into RAM.
+        uint64_t invalidations;
+    };
+
+    // straight-line code from start up to and including its terminator.
+    struct Block {
+        // covers RAM[start, end)
+        uint16_t start;
+        uint16_t end;
+        std::vector<DecodedInstruction> code;
+        // number of executions, counted until the block is compiled.
+        uint32_t hits{0};
+        // compiled code, nullptr until the block is hot.
+        void (*native)(Chip8Interpreter *self){nullptr};
+    };
+
+    struct BlockCacheStats {
+        uint64_t translations;
+        // blocks dropped by writes into RAM.
+        uint64_t invalidations;
+    };
+
+    Engine engine{Engine::Interpreter};
+
+    // skip idle loops in Step.
+    bool skipIdle{true};
+
+    // record executed instructions into the trace ring, see StartTrace.
+    // compiled blocks (JIT and AOT) don't run while tracing.
+    bool tracing{false};
+
+    // keep memoryHash up to date on every store, see StartHashing.
+    bool hashing{false};
+    // Zobrist hash of RAM, STACK and BUFFER while hashing: the XOR of a
+    // term per byte of RAM, word of STACK and row of BUFFER, each store
+    // swapping the term of the old value for the new one.
+    uint64_t memoryHash{0};
+
+    // BUFFER changed since the frontend last presented it, cleared by the frontend.
+    bool drawFlag{true};
+    // rows of BUFFER changed since the frontend last presented it, cleared by the frontend.
+    uint32_t dirtyRows{0xFFFFFFFF};
+    // length of the beep requested by the sound timer, cleared by the frontend.
+    int beepMilliseconds{0};
+
+    // frames run and instructions executed since construction.
+    uint64_t frameCount{0};
+    uint64_t instructionCount{0};
+    // part of instructionCount skipped in idle loops, see Step.
+    uint64_t idleInstructionCount{0};
+
+private:
+    // registers at the head of a possible idle loop, see Step.
+    struct IdleWatch {
+        uint16_t PC;
+        // instructions executed by Step and stores when the head was reached.
+        uint64_t executed;
+        uint64_t stores;
+        std::array<uint8_t, 16> V;
+        uint16_t I;
+        uint8_t SP;
+        uint8_t DT;
+        uint8_t ST;
+        uint64_t RND;
+    };
+
+    // writes into RAM, the stack or the screen, counted to tell idle loops apart.
+    uint64_t storeCount{0};
+
+    void Watch(IdleWatch &watch, uint64_t executed) const;
+
+    // the registers and memory are as they were at watch.
+    bool Unchanged(const IdleWatch &watch) const;
+
+    // decoded instruction cache, one entry for every address of RAM.
+    std::array<DecodedInstruction, 0x1000> decodeCache{};
+    // translated blocks by start address.
+    std::array<std::unique_ptr<Block>, 0x1000> blockCache{};
+    // addresses covered by at least one translated block.
+    std::bitset<0x1000> blockCode{};
+    // created with the first compiled block.
+    std::unique_ptr<Jit> jit;
+    // created by the first StartTrace.
+    std::unique_ptr<TraceRing> traceRing;
+    // blocks of the loaded ROM compiled ahead of time, by start address.
+    std::array<const AotBlock *, 0x1000> aotBlocks{};
+
+public:
+    DecodeCacheStats decodeCacheStats{};
+    BlockCacheStats blockCacheStats{};
+
+#ifdef CHIP8_PROFILE
+    // every instruction runs through a handler: no compiled blocks, no AOT blocks.
+    Profile profile;
+#endif
+
+    Chip8Interpreter();
+
+    ~Chip8Interpreter();
+
+    Chip8Interpreter(const Chip8Interpreter &) = delete;
+
+    Chip8Interpreter &operator=(const Chip8Interpreter &) = delete;
+
+    bool Load(const std::string& file);
+
+    // load size bytes of rom at 0x200, clamped to RAM.
+    void Load(const uint8_t *rom, size_t size);
+
+    // restart the random number generator from seed, for reproducible runs.
+    void Seed(uint64_t seed);
+
+    // copy the machine into snapshot.
+    void SaveState(Chip8Snapshot &snapshot) const;
+
+    // restore the machine from snapshot, false when it has another format.
+    bool LoadState(const Chip8Snapshot &snapshot);
+
+    // restore the machine with the memoryHash it had, instead of hashing its memory again.
+    bool LoadState(const Chip8Snapshot &snapshot, uint64_t hash);
+
+    bool SaveStateFile(const std::string &file) const;
+
+    bool LoadStateFile(const std::string &file);
+
+    // start tracing into a ring of at least records, kept when it is large enough.
+    void StartTrace(size_t records);
+
+    void StopTrace();
+
+    // nullptr before the first StartTrace.
+    const TraceRing *Trace() const;
+
+    // hash the memory and keep hashing it on every store.
+    void StartHashing();
+
+    // hash of RAM, STACK and BUFFER from scratch, what memoryHash is while hashing.
+    uint64_t HashMemory() const;
+
+    // memoryHash combined with the registers: the whole machine, without
+    // going over its memory. only meaningful while hashing.
+    uint64_t IncrementalHash() const;
+
+    // decode the instruction at address, through the decode cache.
+    const DecodedInstruction &DecodeAt(uint16_t address);
+
+    // drop cached decodes overlapping RAM[address, address + length).
+    void InvalidateCode(uint16_t address, uint16_t length);
+
+    // execute the instruction at PC.
+    void ExecuteInstruction();
+
+    // execute up to cycles instructions with the selected engine, return the number executed.
+    // a loop found to spin without effect (JP to itself, polling DT or the keys,
+    // LD Vx, K waiting) is skipped to the end of cycles, see Step.
+    uint64_t Step(uint64_t cycles);
+
+    // one frame: cyclesPerFrame instructions, then the timers.
+    void RunFrame();
+
+    // count the delay and sound timers down by one frame.
+    void TickTimers();
+
+    void KeyDown(int key);
+
+    void KeyUp(int key);
+
+    // translate the block starting at address.
+    std::unique_ptr<Block> TranslateBlock(uint16_t address);
+
+    // compile block to native code.
+    void CompileBlock(Block &block);
+
+    // execute the block at PC, return the number of instructions executed.
+    // a single instruction when the block is longer than budget.
+    uint32_t ExecuteBlock(uint32_t budget);
+
+    // execute the ahead of time compiled block at PC, return the number of instructions executed.
+    // a single instruction when there is none or it is longer than budget.
+    uint32_t ExecuteAot(uint32_t budget);
+
+    void Push(uint16_t opcode);
+
+    // write a byte of RAM, through the memory hash.
+    void Store(uint16_t address, uint8_t value);
+
+    uint16_t Pop();
+
+    // implement instructions
+    void UNKNOWN(Instruction ins);
+
+    void CLS(Instruction ins);
+
+    void RET(Instruction ins);
+
+    void JP_Addr(Instruction ins);
+
+    void CALL_Addr(Instruction ins);
+
+    void SE_Vx_Byte(Instruction ins);
+
+    void SNE_Vx_Byte(Instruction ins);
+
+    void SE_Vx_Vy(Instruction ins);
+
+    void LD_Vx_Byte(Instruction ins);
+
+    void ADD_Vx_Byte(Instruction ins);
+
+    void LD_Vx_Vy(Instruction ins);
+
+    void OR_Vx_Vy(Instruction ins);
+
+    void AND_Vx_Vy(Instruction ins);
+
+    void XOR_Vx_Vy(Instruction ins);
+
+    void ADD_Vx_Vy(Instruction ins);
+
+    void SUB_Vx_Vy(Instruction ins);
+
+    void SHR_Vx_iVy(Instruction ins);
+
+    void SUBN_Vx_Vy(Instruction ins);
+
+    void SHL_Vx_iVy(Instruction ins);
+
+    void SNE_Vx_Vy(Instruction ins);
+
+    void LD_I_Addr(Instruction ins);
+
+    void JP_V0_Addr(Instruction ins);
+
+    void RND_Vx_KK(Instruction ins);
+
+    void DRW_Vx_Vy_N(Instruction ins);
+
+    void SKP_Vx(Instruction ins);
+
+    void SKNP_Vx(Instruction ins);
+
+    void LD_Vx_DT(Instruction ins);
+
+    void LD_Vx_K(Instruction ins);
+
+    void LD_DT_Vx(Instruction ins);
+
+    void LD_ST_Vx(Instruction ins);
+
+    void ADD_I_Vx(Instruction ins);
+
+    void LD_F_Vx(Instruction ins);
+
+    void LD_B_Vx(Instruction ins);
+
+    void LD_I_Vx(Instruction ins);
+
+    void LD_Vx_I(Instruction ins);
+};
+
+#endif // CHIP8INTERPRETER_H
@@ -0,0 +1,40 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include <charconv>
+#include <string>
+#include <system_error>
+
+#include "chip8interpreter.h"
+
+// argument parsing shared by the executables.
+
+// false unless all of text is a number of at least min, value is then left as is.
+template<typename T>
+bool ParseNumber(const std::string &text, T min, T &value) {
+    T parsed{};
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (error != std::errc() || end != text.data() + text.size() || parsed < min) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// --engine=interpreter|block|jit|aot, false for any other argument.
+inline bool ParseEngine(const std::string &arg, Engine &engine) {
+    if (arg == "--engine=interpreter") {
+        engine = Engine::Interpreter;
+    } else if (arg == "--engine=block") {
+        engine = Engine::Block;
+    } else if (arg == "--engine=jit") {
+        engine = Engine::Jit;
+    } else if (arg == "--engine=aot") {
+        engine = Engine::Aot;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+#endif // CLI_H
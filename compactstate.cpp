@@ -0,0 +1,113 @@
+#include "compactstate.h"
+
+#include <bitset>
+#include <cstring>
+
+static_assert(0x1000 % RomImage::pageSize == 0 && Chip8State::stackSize * 2 % RomImage::pageSize == 0 &&
+              Chip8State::screenHeight * 8 % RomImage::pageSize == 0, "pages split RAM, STACK and BUFFER evenly");
+
+RomImage::RomImage(const Chip8State &loaded) {
+    for (int page = 0; page < pageCount; page++) {
+        std::memcpy(pages[page].data(), PageOf(loaded, page), pageSize);
+    }
+}
+
+const uint8_t *RomImage::PageOf(const Chip8State &state, int page) {
+    return PageOf(const_cast<Chip8State &>(state), page);
+}
+
+uint8_t *RomImage::PageOf(Chip8State &state, int page) {
+    if (page < ramPages) {
+        return state.RAM.data() + page * pageSize;
+    }
+    page -= ramPages;
+    if (page < stackPages) {
+        return reinterpret_cast<uint8_t *>(state.STACK.data()) + page * pageSize;
+    }
+    page -= stackPages;
+    return reinterpret_cast<uint8_t *>(state.BUFFER.data()) + page * pageSize;
+}
+
+CompactState::CompactState(std::shared_ptr<const RomImage> image) : image{std::move(image)} {
+}
+
+CompactState::CompactState(const CompactState &other) : registers{other.registers}, mask{other.mask},
+                                                         image{other.image} {
+    size_t size = other.OwnPages() * RomImage::pageSize;
+    if (size > 0) {
+        own = std::make_unique<uint8_t[]>(size);
+        std::memcpy(own.get(), other.own.get(), size);
+    }
+}
+
+CompactState &CompactState::operator=(const CompactState &other) {
+    if (this != &other) {
+        *this = CompactState(other);
+    }
+    return *this;
+}
+
+void CompactState::Pack(const Chip8State &state) {
+    registers.V = state.V;
+    registers.RND = state.RND.state;
+    registers.I = state.I;
+    registers.PC = state.PC;
+    registers.INPUTS = state.INPUTS;
+    registers.DT = state.DT;
+    registers.ST = state.ST;
+    registers.SP = state.SP;
+
+    std::array<uint64_t, (RomImage::pageCount + 63) / 64> differ{};
+    int count = 0;
+    for (int page = 0; page < RomImage::pageCount; page++) {
+        if (std::memcmp(RomImage::PageOf(state, page), image->Page(page), RomImage::pageSize) != 0) {
+            differ[page / 64] |= 1ull << (page % 64);
+            count++;
+        }
+    }
+    // a state packed over again usually keeps the number of its pages.
+    if (count != OwnPages()) {
+        own = count > 0 ? std::make_unique<uint8_t[]>(count * RomImage::pageSize) : nullptr;
+    }
+    mask = differ;
+    uint8_t *out = own.get();
+    for (int page = 0; page < RomImage::pageCount; page++) {
+        if (mask[page / 64] >> (page % 64) & 1) {
+            std::memcpy(out, RomImage::PageOf(state, page), RomImage::pageSize);
+            out += RomImage::pageSize;
+        }
+    }
+}
+
+void CompactState::Unpack(Chip8State &state) const {
+    state.V = registers.V;
+    state.RND.state = registers.RND;
+    state.I = registers.I;
+    state.PC = registers.PC;
+    state.INPUTS = registers.INPUTS;
+    state.DT = registers.DT;
+    state.ST = registers.ST;
+    state.SP = registers.SP;
+
+    const uint8_t *in = own.get();
+    for (int page = 0; page < RomImage::pageCount; page++) {
+        if (mask[page / 64] >> (page % 64) & 1) {
+            std::memcpy(RomImage::PageOf(state, page), in, RomImage::pageSize);
+            in += RomImage::pageSize;
+        } else {
+            std::memcpy(RomImage::PageOf(state, page), image->Page(page), RomImage::pageSize);
+        }
+    }
+}
+
+int CompactState::OwnPages() const {
+    int count = 0;
+    for (uint64_t word: mask) {
+        count += (int) std::bitset<64>(word).count();
+    }
+    return count;
+}
+
+size_t CompactState::Bytes() const {
+    return sizeof(CompactState) + OwnPages() * RomImage::pageSize;
+}
@@ -0,0 +1,89 @@
+#ifndef COMPACTSTATE_H
+#define COMPACTSTATE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "chip8interpreter.h"
+
+// RAM, STACK and BUFFER of a machine as loaded, split into pages: the
+// pages shared by the CompactStates of one ROM.
+class RomImage {
+public:
+    const static int pageSize{64};
+    // RAM, then STACK, then BUFFER, no page straddles two of them.
+    const static int ramPages{0x1000 / pageSize};
+    const static int stackPages{Chip8State::stackSize * 2 / pageSize};
+    const static int screenPages{Chip8State::screenHeight * 8 / pageSize};
+    const static int pageCount{ramPages + stackPages + screenPages};
+
+    // loaded: a machine right after Load, its font and ROM.
+    explicit RomImage(const Chip8State &loaded);
+
+    const uint8_t *Page(int page) const {
+        return pages[page].data();
+    }
+
+    // page of state, the same part of it as Page of the image.
+    static const uint8_t *PageOf(const Chip8State &state, int page);
+
+    static uint8_t *PageOf(Chip8State &state, int page);
+
+private:
+    std::array<std::array<uint8_t, pageSize>, pageCount> pages;
+};
+
+// a machine in a few hundred bytes, for keeping many of them resident.
+//
+// the registers are stored inline. the pages of RAM, stack and screen are
+// read from the shared RomImage, except those that differ from it: the
+// pages of RAM written by Fx33/Fx55, the used part of the stack and the
+// drawn part of the screen. those are copied into the state, packed in
+// page order behind a bitmask.
+class CompactState {
+public:
+    explicit CompactState(std::shared_ptr<const RomImage> image);
+
+    CompactState(const CompactState &other);
+
+    CompactState &operator=(const CompactState &other);
+
+    CompactState(CompactState &&) = default;
+
+    CompactState &operator=(CompactState &&) = default;
+
+    // store state, copying only the pages that differ from the image.
+    void Pack(const Chip8State &state);
+
+    // the whole machine back. into a Chip8Interpreter through a
+    // Chip8Snapshot and LoadState.
+    void Unpack(Chip8State &state) const;
+
+    // pages copied from the image.
+    int OwnPages() const;
+
+    // memory taken by the state, its own pages included.
+    size_t Bytes() const;
+
+private:
+    struct Registers {
+        std::array<uint8_t, 16> V;
+        uint64_t RND;
+        uint16_t I;
+        uint16_t PC;
+        uint16_t INPUTS;
+        uint8_t DT;
+        uint8_t ST;
+        uint8_t SP;
+    };
+
+    Registers registers{};
+    // bit p set when page p is in own.
+    std::array<uint64_t, (RomImage::pageCount + 63) / 64> mask{};
+    std::unique_ptr<uint8_t[]> own;
+    std::shared_ptr<const RomImage> image;
+};
+
+#endif // COMPACTSTATE_H
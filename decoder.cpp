@@ -0,0 +1,266 @@
+#include "decoder.h"
+
+#include <cstdio>
+
+// the same rules the function map applies: the high nibble selects the
+// family, N or KK selects the operation inside families 0, 8, E and F.
+static Op DecodeSlow(uint16_t opcode) {
+    uint8_t KK = opcode & 0x00FF;
+    uint8_t N = opcode & 0x000F;
+
+    switch (opcode >> 12) {
+        case 0x0:
+            if (KK == 0xE0) {
+                return Op::CLS;
+            } else if (KK == 0xEE) {
+                return Op::RET;
+            }
+            return Op::UNKNOWN;
+        case 0x1:
+            return Op::JP_Addr;
+        case 0x2:
+            return Op::CALL_Addr;
+        case 0x3:
+            return Op::SE_Vx_Byte;
+        case 0x4:
+            return Op::SNE_Vx_Byte;
+        case 0x5:
+            return Op::SE_Vx_Vy;
+        case 0x6:
+            return Op::LD_Vx_Byte;
+        case 0x7:
+            return Op::ADD_Vx_Byte;
+        case 0x8:
+            switch (N) {
+                case 0x0:
+                    return Op::LD_Vx_Vy;
+                case 0x1:
+                    return Op::OR_Vx_Vy;
+                case 0x2:
+                    return Op::AND_Vx_Vy;
+                case 0x3:
+                    return Op::XOR_Vx_Vy;
+                case 0x4:
+                    return Op::ADD_Vx_Vy;
+                case 0x5:
+                    return Op::SUB_Vx_Vy;
+                case 0x6:
+                    return Op::SHR_Vx_iVy;
+                case 0x7:
+                    return Op::SUBN_Vx_Vy;
+                case 0xE:
+                    return Op::SHL_Vx_iVy;
+                default:
+                    return Op::UNKNOWN;
+            }
+        case 0x9:
+            return Op::SNE_Vx_Vy;
+        case 0xA:
+            return Op::LD_I_Addr;
+        case 0xB:
+            return Op::JP_V0_Addr;
+        case 0xC:
+            return Op::RND_Vx_KK;
+        case 0xD:
+            return Op::DRW_Vx_Vy_N;
+        case 0xE:
+            switch (KK) {
+                case 0x9E:
+                    return Op::SKP_Vx;
+                case 0xA1:
+                    return Op::SKNP_Vx;
+                default:
+                    return Op::UNKNOWN;
+            }
+        case 0xF:
+            switch (KK) {
+                case 0x07:
+                    return Op::LD_Vx_DT;
+                case 0x0A:
+                    return Op::LD_Vx_K;
+                case 0x15:
+                    return Op::LD_DT_Vx;
+                case 0x18:
+                    return Op::LD_ST_Vx;
+                case 0x1E:
+                    return Op::ADD_I_Vx;
+                case 0x29:
+                    return Op::LD_F_Vx;
+                case 0x33:
+                    return Op::LD_B_Vx;
+                case 0x55:
+                    return Op::LD_I_Vx;
+                case 0x65:
+                    return Op::LD_Vx_I;
+                default:
+                    return Op::UNKNOWN;
+            }
+        default:
+            return Op::UNKNOWN;
+    }
+}
+
+static std::array<Op, 0x10000> BuildDecodeTable() {
+    std::array<Op, 0x10000> table{};
+    for (uint32_t opcode = 0; opcode < 0x10000; opcode++) {
+        table[opcode] = DecodeSlow(opcode);
+    }
+    return table;
+}
+
+const std::array<Op, 0x10000> DECODE_TABLE = BuildDecodeTable();
+
+const char *OpName(Op op) {
+    const static char *names[] = {
+            "UNKNOWN",
+            "CLS",
+            "RET",
+            "JP_Addr",
+            "CALL_Addr",
+            "SE_Vx_Byte",
+            "SNE_Vx_Byte",
+            "SE_Vx_Vy",
+            "LD_Vx_Byte",
+            "ADD_Vx_Byte",
+            "LD_Vx_Vy",
+            "OR_Vx_Vy",
+            "AND_Vx_Vy",
+            "XOR_Vx_Vy",
+            "ADD_Vx_Vy",
+            "SUB_Vx_Vy",
+            "SHR_Vx_iVy",
+            "SUBN_Vx_Vy",
+            "SHL_Vx_iVy",
+            "SNE_Vx_Vy",
+            "LD_I_Addr",
+            "JP_V0_Addr",
+            "RND_Vx_KK",
+            "DRW_Vx_Vy_N",
+            "SKP_Vx",
+            "SKNP_Vx",
+            "LD_Vx_DT",
+            "LD_Vx_K",
+            "LD_DT_Vx",
+            "LD_ST_Vx",
+            "ADD_I_Vx",
+            "LD_F_Vx",
+            "LD_B_Vx",
+            "LD_I_Vx",
+            "LD_Vx_I",
+    };
+    return op < Op::COUNT ? names[(size_t) op] : "UNKNOWN";
+}
+
+void Disassemble(uint16_t opcode, char *text, size_t size) {
+    Instruction ins = ParseInstruction(opcode);
+    int x = ins.X;
+    int y = ins.Y;
+    switch (Decode(opcode)) {
+        case Op::CLS:
+            snprintf(text, size, "CLS");
+            break;
+        case Op::RET:
+            snprintf(text, size, "RET");
+            break;
+        case Op::JP_Addr:
+            snprintf(text, size, "JP 0x%03X", ins.NNN);
+            break;
+        case Op::CALL_Addr:
+            snprintf(text, size, "CALL 0x%03X", ins.NNN);
+            break;
+        case Op::SE_Vx_Byte:
+            snprintf(text, size, "SE V%X, 0x%02X", x, ins.KK);
+            break;
+        case Op::SNE_Vx_Byte:
+            snprintf(text, size, "SNE V%X, 0x%02X", x, ins.KK);
+            break;
+        case Op::SE_Vx_Vy:
+            snprintf(text, size, "SE V%X, V%X", x, y);
+            break;
+        case Op::LD_Vx_Byte:
+            snprintf(text, size, "LD V%X, 0x%02X", x, ins.KK);
+            break;
+        case Op::ADD_Vx_Byte:
+            snprintf(text, size, "ADD V%X, 0x%02X", x, ins.KK);
+            break;
+        case Op::LD_Vx_Vy:
+            snprintf(text, size, "LD V%X, V%X", x, y);
+            break;
+        case Op::OR_Vx_Vy:
+            snprintf(text, size, "OR V%X, V%X", x, y);
+            break;
+        case Op::AND_Vx_Vy:
+            snprintf(text, size, "AND V%X, V%X", x, y);
+            break;
+        case Op::XOR_Vx_Vy:
+            snprintf(text, size, "XOR V%X, V%X", x, y);
+            break;
+        case Op::ADD_Vx_Vy:
+            snprintf(text, size, "ADD V%X, V%X", x, y);
+            break;
+        case Op::SUB_Vx_Vy:
+            snprintf(text, size, "SUB V%X, V%X", x, y);
+            break;
+        case Op::SHR_Vx_iVy:
+            snprintf(text, size, "SHR V%X {, V%X}", x, y);
+            break;
+        case Op::SUBN_Vx_Vy:
+            snprintf(text, size, "SUBN V%X, V%X", x, y);
+            break;
+        case Op::SHL_Vx_iVy:
+            snprintf(text, size, "SHL V%X {, V%X}", x, y);
+            break;
+        case Op::SNE_Vx_Vy:
+            snprintf(text, size, "SNE V%X, V%X", x, y);
+            break;
+        case Op::LD_I_Addr:
+            snprintf(text, size, "LD I, 0x%03X", ins.NNN);
+            break;
+        case Op::JP_V0_Addr:
+            snprintf(text, size, "JP V0, 0x%03X", ins.NNN);
+            break;
+        case Op::RND_Vx_KK:
+            snprintf(text, size, "RND V%X, 0x%02X", x, ins.KK);
+            break;
+        case Op::DRW_Vx_Vy_N:
+            snprintf(text, size, "DRW V%X, V%X, %d", x, y, ins.N);
+            break;
+        case Op::SKP_Vx:
+            snprintf(text, size, "SKP V%X", x);
+            break;
+        case Op::SKNP_Vx:
+            snprintf(text, size, "SKNP V%X", x);
+            break;
+        case Op::LD_Vx_DT:
+            snprintf(text, size, "LD V%X, DT", x);
+            break;
+        case Op::LD_Vx_K:
+            snprintf(text, size, "LD V%X, K", x);
+            break;
+        case Op::LD_DT_Vx:
+            snprintf(text, size, "LD DT, V%X", x);
+            break;
+        case Op::LD_ST_Vx:
+            snprintf(text, size, "LD ST, V%X", x);
+            break;
+        case Op::ADD_I_Vx:
+            snprintf(text, size, "ADD I, V%X", x);
+            break;
+        case Op::LD_F_Vx:
+            snprintf(text, size, "LD F, V%X", x);
+            break;
+        case Op::LD_B_Vx:
+            snprintf(text, size, "LD B, V%X", x);
+            break;
+        case Op::LD_I_Vx:
+            snprintf(text, size, "LD [I], V%X", x);
+            break;
+        case Op::LD_Vx_I:
+            snprintf(text, size, "LD V%X, [I]", x);
+            break;
+        default:
+            // 0nnn SYS and anything else is ignored.
+            snprintf(text, size, "DW 0x%04X", opcode);
+            break;
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct Instruction {
+    uint16_t opcode;
+    uint16_t NNN;
+    uint8_t KK, X, Y, N;
+};
+
+// one operation for each instruction method of Chip8Interpreter.
+enum class Op : uint8_t {
+    UNKNOWN,
+    CLS,
+    RET,
+    JP_Addr,
+    CALL_Addr,
+    SE_Vx_Byte,
+    SNE_Vx_Byte,
+    SE_Vx_Vy,
+    LD_Vx_Byte,
+    ADD_Vx_Byte,
+    LD_Vx_Vy,
+    OR_Vx_Vy,
+    AND_Vx_Vy,
+    XOR_Vx_Vy,
+    ADD_Vx_Vy,
+    SUB_Vx_Vy,
+    SHR_Vx_iVy,
+    SUBN_Vx_Vy,
+    SHL_Vx_iVy,
+    SNE_Vx_Vy,
+    LD_I_Addr,
+    JP_V0_Addr,
+    RND_Vx_KK,
+    DRW_Vx_Vy_N,
+    SKP_Vx,
+    SKNP_Vx,
+    LD_Vx_DT,
+    LD_Vx_K,
+    LD_DT_Vx,
+    LD_ST_Vx,
+    ADD_I_Vx,
+    LD_F_Vx,
+    LD_B_Vx,
+    LD_I_Vx,
+    LD_Vx_I,
+    COUNT
+};
+
+// opcode -> operation, one entry for every 16 bit opcode.
+extern const std::array<Op, 0x10000> DECODE_TABLE;
+
+// translate opcode into Instruction object.
+inline Instruction ParseInstruction(uint16_t opcode) {
+    Instruction ins{};
+    ins.opcode = opcode;
+    ins.NNN = opcode & 0x0FFF;
+    ins.KK = opcode & 0x00FF;
+    ins.X = (opcode & 0x0F00) >> 8;
+    ins.Y = (opcode & 0x00F0) >> 4;
+    ins.N = opcode & 0x000F;
+    return ins;
+}
+
+// resolve the operation of an opcode, a single table lookup.
+inline Op Decode(uint16_t opcode) {
+    return DECODE_TABLE[opcode];
+}
+
+// name of the operation, the same as its Chip8Interpreter method.
+const char *OpName(Op op);
+
+// assembly text of opcode, e.g. "LD V1, 0x2A". writes at most size bytes with the terminator.
+void Disassemble(uint16_t opcode, char *text, size_t size);
+
+// operations that may not continue at PC + 2: jumps, calls, returns, skips,
+// LD Vx, K (waits on PC) and unknown opcodes. the stores Fx33 and Fx55 end
+// a block as well, since they may rewrite the code that follows them.
+inline bool IsBlockTerminator(Op op) {
+    switch (op) {
+        case Op::UNKNOWN:
+        case Op::RET:
+        case Op::JP_Addr:
+        case Op::CALL_Addr:
+        case Op::SE_Vx_Byte:
+        case Op::SNE_Vx_Byte:
+        case Op::SE_Vx_Vy:
+        case Op::SNE_Vx_Vy:
+        case Op::JP_V0_Addr:
+        case Op::SKP_Vx:
+        case Op::SKNP_Vx:
+        case Op::LD_Vx_K:
+        case Op::LD_B_Vx:
+        case Op::LD_I_Vx:
+            return true;
+        default:
+            return false;
+    }
+}
+
+#endif // DECODER_H
@@ -0,0 +1,294 @@
+#include "emulator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+const static int64_t frameNanoseconds = 1000000000 / Chip8Interpreter::frameRate;
+
+Emulator::Emulator(const EmulatorOptions &options, TripleBuffer<Frame> &frames, Keypad &keypad, QObject *parent)
+        : QObject{parent}, frames{frames}, keypad{keypad}, rewind{options.rewindBytes} {
+    core.engine = options.engine;
+    core.cyclesPerFrame = options.cyclesPerFrame;
+    turbo = options.turbo;
+    runAhead = options.runAhead;
+    profileFile = options.profile;
+    traceRecords = options.traceRecords;
+    traceFile = options.traceFile;
+    if (options.trace) {
+        core.StartTrace(traceRecords);
+    }
+    if (runAhead > 0) {
+        aheadState = std::make_unique<Chip8Snapshot>();
+#ifdef CHIP8_PROFILE
+        aheadProfile = std::make_unique<Profile>();
+#endif
+    }
+
+    // child of the emulator, so it follows it to the emulation thread.
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &Emulator::Tick);
+
+    if (!options.record.empty()) {
+        movie = std::make_unique<Movie>();
+        movie->seed = (uint64_t) std::random_device{}() << 32 | std::random_device{}();
+        movie->cyclesPerFrame = options.cyclesPerFrame;
+        movieFile = options.record;
+    }
+}
+
+Emulator::~Emulator() {
+    if (core.tracing) {
+        SaveTrace();
+    }
+#ifdef CHIP8_PROFILE
+    SaveProfile();
+#endif
+    if (movie) {
+        if (movie->Save(movieFile)) {
+            std::cout << "movie saved: " << movieFile << std::endl;
+        } else {
+            std::cout << "fail to save movie: " << movieFile << std::endl;
+        }
+    }
+}
+
+void Emulator::Start() {
+    if (movie) {
+        movie->Start(core);
+    }
+    rewind.Push(core);
+    clock.start();
+    scheduledFrames = 0;
+    statsClock.start();
+    timer->start(0);
+}
+
+void Emulator::SetTurbo(bool enabled) {
+    if (turbo && !enabled) {
+        // back to real time from now on.
+        clock.restart();
+        scheduledFrames = 0;
+    }
+    turbo = enabled;
+}
+
+void Emulator::SetRewind(bool enabled) {
+    if (movie) {
+        return;
+    }
+    if (turbo && enabled) {
+        // rewinding runs in real time.
+        clock.restart();
+        scheduledFrames = 0;
+    }
+    rewinding = enabled;
+}
+
+void Emulator::QuickSave() {
+    if (!quickSave) {
+        quickSave = std::make_unique<Chip8Snapshot>();
+    }
+    core.SaveState(*quickSave);
+}
+
+void Emulator::QuickLoad() {
+    if (quickSave && !movie) {
+        core.LoadState(*quickSave);
+    }
+}
+
+void Emulator::SaveProfile() {
+#ifdef CHIP8_PROFILE
+    if (core.profile.Save(profileFile)) {
+        std::cout << "profile saved: " << profileFile << std::endl;
+    } else {
+        std::cout << "fail to save profile: " << profileFile << std::endl;
+    }
+#else
+    std::cout << "built without CHIP8_PROFILE, no profile to save." << std::endl;
+#endif
+}
+
+void Emulator::SetTrace(bool enabled) {
+    if (enabled) {
+        core.StartTrace(traceRecords);
+    } else {
+        core.StopTrace();
+    }
+}
+
+void Emulator::SaveTrace() {
+    if (core.Trace() == nullptr) {
+        std::cout << "nothing traced." << std::endl;
+    } else if (core.Trace()->Save(traceFile)) {
+        std::cout << "trace saved: " << traceFile << std::endl;
+    } else {
+        std::cout << "fail to save trace: " << traceFile << std::endl;
+    }
+}
+
+void Emulator::Tick() {
+    if (turbo && !rewinding) {
+        // run frames for one display refresh, then go back to the event loop for input.
+        QElapsedTimer slice;
+        slice.start();
+        while (slice.nsecsElapsed() < frameNanoseconds) {
+            RunFrame();
+        }
+        Present();
+        UpdateStats();
+        timer->start(0);
+        return;
+    }
+
+    int64_t due = clock.nsecsElapsed() / frameNanoseconds;
+    scheduledFrames = std::max(scheduledFrames, due - maxCatchUp);
+    for (; scheduledFrames < due; scheduledFrames++) {
+        if (rewinding) {
+            rewind.StepBack(core);
+        } else {
+            RunFrame();
+        }
+    }
+    Present();
+    UpdateStats();
+
+    int64_t next = (scheduledFrames + 1) * frameNanoseconds - clock.nsecsElapsed();
+    timer->start(std::max<int64_t>(0, (next + 999999) / 1000000));
+}
+
+void Emulator::PollKeys() {
+    int64_t now = Keypad::Now();
+    uint16_t keys = keypad.Keys();
+    uint16_t changed = keys ^ core.INPUTS;
+    if (changed != 0) {
+        if (movie) {
+            for (int key = 0; key < 16; key++) {
+                if (changed >> key & 1) {
+                    movie->RecordKey(key, keys >> key & 1);
+                }
+            }
+        }
+        // probe a key pressed since the last poll, not one restored by a rewind or a load.
+        int64_t changedAt = keypad.ChangedAt();
+        if ((keys & ~core.INPUTS) != 0 && changedAt > polledAt && probePressedAt == 0) {
+            probePressedAt = changedAt;
+            probeObservedAt = now;
+        }
+        core.INPUTS = keys;
+    }
+    polledAt = now;
+}
+
+void Emulator::RunFrame() {
+    PollKeys();
+    core.RunFrame();
+    if (movie) {
+        movie->RecordFrame(core);
+    }
+    rewind.Push(core);
+}
+
+void Emulator::Present() {
+#ifdef CHIP8_PROFILE
+    Profile::Scope scope(core.profile.present);
+#endif
+    if (core.beepMilliseconds > 0) {
+        emit beep(core.beepMilliseconds);
+        core.beepMilliseconds = 0;
+    }
+    if (runAhead > 0 && !rewinding && !turbo) {
+        // the screen runAhead frames from now, redrawn where it differs from the last one.
+        Chip8Interpreter::Screen screen = RunAhead();
+        uint32_t rows = 0;
+        for (int row = 0; row < Chip8Interpreter::screenHeight; row++) {
+            if (screen[row] != presented[row]) {
+                rows |= 1u << row;
+            }
+        }
+        if (rows != 0) {
+            Publish(screen, rows);
+        }
+    } else if (core.drawFlag) {
+        Publish(core.BUFFER, core.dirtyRows);
+    }
+    core.drawFlag = false;
+    core.dirtyRows = 0;
+}
+
+Chip8Interpreter::Screen Emulator::RunAhead() {
+    core.SaveState(*aheadState);
+    // what the frontend reads from the core, the speculative frames must not change it.
+    bool drawFlag = core.drawFlag;
+    uint32_t dirtyRows = core.dirtyRows;
+    int beepMilliseconds = core.beepMilliseconds;
+    uint64_t frameCount = core.frameCount;
+    uint64_t instructionCount = core.instructionCount;
+    uint64_t idleInstructionCount = core.idleInstructionCount;
+    // nor the trace and the profile, the speculative instructions never happen.
+    bool tracing = core.tracing;
+    core.tracing = false;
+#ifdef CHIP8_PROFILE
+    *aheadProfile = core.profile;
+#endif
+
+    for (int i = 0; i < runAhead; i++) {
+        core.RunFrame();
+    }
+    Chip8Interpreter::Screen screen = core.BUFFER;
+
+    core.LoadState(*aheadState);
+    core.drawFlag = drawFlag;
+    core.dirtyRows = dirtyRows;
+    core.beepMilliseconds = beepMilliseconds;
+    core.frameCount = frameCount;
+    core.instructionCount = instructionCount;
+    core.idleInstructionCount = idleInstructionCount;
+    core.tracing = tracing;
+#ifdef CHIP8_PROFILE
+    core.profile = *aheadProfile;
+#endif
+    return screen;
+}
+
+void Emulator::Publish(const Chip8Interpreter::Screen &screen, uint32_t rows) {
+    // a dropped frame never reaches the consumer, so its rows are carried
+    // in every frame until one is published after a consumed frame.
+    pendingRows |= rows;
+    Frame &frame = frames.Back();
+    frame.buffer = screen;
+    frame.dirtyRows = pendingRows;
+    // the probe is carried the same way, until a frame with it is consumed.
+    frame.pressedAt = probePressedAt;
+    frame.observedAt = probeObservedAt;
+    frame.publishedAt = Keypad::Now();
+    bool consumed = frames.Publish();
+    if (consumed && probePublished) {
+        probePressedAt = 0;
+    }
+    probePublished = probePressedAt != 0;
+    if (consumed) {
+        pendingRows = rows;
+        emit frameReady();
+    }
+    presented = screen;
+}
+
+void Emulator::UpdateStats() {
+    int64_t elapsed = statsClock.nsecsElapsed();
+    if (elapsed < 1000000000) {
+        return;
+    }
+    double seconds = elapsed / 1e9;
+    uint64_t instructions = core.instructionCount - statsInstructions;
+    double idleFraction = instructions > 0 ? (double) (core.idleInstructionCount - statsIdleInstructions) / instructions : 0;
+    emit stats((core.frameCount - statsFrames) / seconds, instructions / seconds, idleFraction,
+               (double) rewind.Frames() / Chip8Interpreter::frameRate, rewind.Used(), rewind.Budget());
+    statsFrames = core.frameCount;
+    statsInstructions = core.instructionCount;
+    statsIdleInstructions = core.idleInstructionCount;
+    statsClock.restart();
+}
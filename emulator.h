@@ -0,0 +1,176 @@
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "chip8interpreter.h"
+#include "triplebuffer.h"
+#include "keypad.h"
+#include "rewind.h"
+#include "movie.h"
+
+// a published frame, with the rows changed since the last frame the consumer took.
+struct Frame {
+    Chip8Interpreter::Screen buffer;
+    uint32_t dirtyRows;
+    // latency probe of the first key press drawn by this frame, in Keypad::Now
+    // nanoseconds: pressed, read by a frame, published. pressedAt is 0 without
+    // a probe; the same probe may come in more than one frame.
+    int64_t pressedAt;
+    int64_t observedAt;
+    int64_t publishedAt;
+};
+
+struct EmulatorOptions {
+    Engine engine{Engine::Interpreter};
+    // instructions per 60Hz frame.
+    int cyclesPerFrame{10};
+    // run frames as fast as the host allows.
+    bool turbo{false};
+    // bytes kept for rewinding, 0 to disable it.
+    size_t rewindBytes{1 << 20};
+    // frames run ahead of the machine for the screen, 0 to disable it.
+    int runAhead{0};
+    // movie file to record into, none when empty.
+    std::string record;
+    // where the profile of a CHIP8_PROFILE build is saved, on exit and on SaveProfile.
+    std::string profile{"chip8-profile.json"};
+    // instructions kept by the trace ring.
+    size_t traceRecords{1 << 16};
+    // trace from the start.
+    bool trace{false};
+    // where the trace is saved, on exit while tracing and on SaveTrace.
+    std::string traceFile{"chip8-trace.bin"};
+};
+
+// runs a Chip8Interpreter on the thread it is moved to.
+//
+// frames run on a fixed 60Hz timestep: every timer tick catches up with the
+// frames due since Start, so timing doesn't drift with host load. in turbo
+// mode frames run back to back and the display is refreshed at 60Hz. while
+// rewinding, every due frame steps back one recorded frame instead.
+//
+// with run-ahead, the screen shown is runAhead frames ahead of the machine,
+// run with the keys down now and thrown away, which hides that many frames
+// of a ROM's own input lag. the beeps and the recorded frames stay real.
+//
+// when recording a movie, rewinding and quick loads are disabled so the
+// movie replays the run exactly. the movie is saved with the emulator.
+class Emulator : public QObject {
+Q_OBJECT
+
+public:
+    // frames run at most in one tick after the host stalled, the rest is dropped.
+    const static int maxCatchUp{5};
+
+    Chip8Interpreter core;
+
+    // frames are published into frames and keys are read from keypad, both owned by the GUI.
+    Emulator(const EmulatorOptions &options, TripleBuffer<Frame> &frames, Keypad &keypad, QObject *parent = nullptr);
+
+    ~Emulator() override;
+
+signals:
+
+    // a frame was published while the previous one had been consumed.
+    void frameReady();
+
+    void beep(int milliseconds);
+
+    // measured about once a second.
+    // idleFraction: part of the instructions skipped in idle loops.
+    void stats(double framesPerSecond, double instructionsPerSecond, double idleFraction,
+               double rewindSeconds, qulonglong rewindUsed, qulonglong rewindBudget);
+
+public slots:
+
+    // start the frame timer, called on the emulation thread.
+    void Start();
+
+    void SetTurbo(bool enabled);
+
+    void SetRewind(bool enabled);
+
+    // keep a snapshot of the machine in memory.
+    void QuickSave();
+
+    // go back to the snapshot of QuickSave.
+    void QuickLoad();
+
+    // save the profile of the core, in a CHIP8_PROFILE build.
+    void SaveProfile();
+
+    void SetTrace(bool enabled);
+
+    // save the instructions in the trace ring, for chip8-trace.
+    void SaveTrace();
+
+private:
+    TripleBuffer<Frame> &frames;
+    Keypad &keypad;
+    // time of the last PollKeys.
+    int64_t polledAt{0};
+    // rows changed since the last frame known to be consumed.
+    uint32_t pendingRows{0};
+    // key press read by a frame and not known to be consumed, 0 when none.
+    int64_t probePressedAt{0};
+    int64_t probeObservedAt{0};
+    // the last published frame carries the probe.
+    bool probePublished{false};
+    bool turbo;
+    bool rewinding{false};
+    int runAhead;
+    // the machine while frames run ahead of it.
+    std::unique_ptr<Chip8Snapshot> aheadState;
+#ifdef CHIP8_PROFILE
+    // the profile while frames run ahead, they are not counted.
+    std::unique_ptr<Profile> aheadProfile;
+#endif
+    // the screen of the last published frame.
+    Chip8Interpreter::Screen presented{};
+    Rewind rewind;
+    // created by the first QuickSave.
+    std::unique_ptr<Chip8Snapshot> quickSave;
+    // recording, nullptr when not.
+    std::unique_ptr<Movie> movie;
+    std::string movieFile;
+    std::string profileFile;
+    size_t traceRecords;
+    std::string traceFile;
+    QTimer *timer;
+    // time since the schedule started, and the frames run in it.
+    QElapsedTimer clock;
+    int64_t scheduledFrames{0};
+    // start of the current measurement.
+    QElapsedTimer statsClock;
+    uint64_t statsFrames{0};
+    uint64_t statsInstructions{0};
+    uint64_t statsIdleInstructions{0};
+
+    void Tick();
+
+    // copy the keys of keypad into core.
+    void PollKeys();
+
+    // run one frame of core and record it.
+    void RunFrame();
+
+    // emit the pending beep, publish the pending frame.
+    void Present();
+
+    // the screen runAhead frames from now, leaving the machine as it is.
+    Chip8Interpreter::Screen RunAhead();
+
+    // publish screen with rows changed since the last published frame.
+    void Publish(const Chip8Interpreter::Screen &screen, uint32_t rows);
+
+    void UpdateStats();
+};
+
+#endif // EMULATOR_H
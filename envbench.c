@@ -0,0 +1,142 @@
+/* chip8_env_bench: environment steps per second of chip8env, from C.
+ *
+ * usage: chip8_env_bench [rom...] [--envs=N] [--steps=N] [--frames=N]
+ *
+ * steps a batch of N environments (256) with random keys, 4 frames a step
+ * by default, observations as bytes and two register probes, as an agent
+ * would. without ROMs runs the ROMs bundled in the rom directory.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chip8env.h"
+
+static const char *bundled[] = {
+        "Breakout (Brix hack) [David Winter, 1997].ch8",
+        "IBM Logo.ch8",
+};
+
+static double Now(void) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double) now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static uint8_t *ReadFile(const char *file, size_t *size) {
+    FILE *stream = fopen(file, "rb");
+    if (stream == NULL) {
+        return NULL;
+    }
+    uint8_t *data = malloc(4096);
+    *size = fread(data, 1, 4096, stream);
+    fclose(stream);
+    return data;
+}
+
+static int Bench(const char *file, uint32_t envs, int steps, uint32_t frames) {
+    size_t size;
+    uint8_t *rom = ReadFile(file, &size);
+    if (rom == NULL) {
+        printf("fail to load rom: %s\n", file);
+        return 1;
+    }
+
+    const uint16_t probes[] = {CHIP8_PROBE_V0 + 0, CHIP8_PROBE_V0 + 0xF};
+    chip8_env_config config;
+    memset(&config, 0, sizeof(config));
+    config.rom = rom;
+    config.rom_size = size;
+    config.count = envs;
+    config.frames_per_step = frames;
+    config.seed = 1;
+    config.observation = CHIP8_OBSERVATION_BYTES;
+    config.probes = probes;
+    config.probe_count = 2;
+    config.reward_probe = 0;
+    chip8_env *env = chip8_env_create(&config);
+    free(rom);
+    if (env == NULL) {
+        printf("fail to create environments: %s\n", file);
+        return 1;
+    }
+
+    uint8_t *observations = malloc(envs * chip8_env_observation_size(env));
+    uint8_t *probeValues = malloc(envs * config.probe_count);
+    float *rewards = malloc(envs * sizeof(float));
+    uint16_t *actions = malloc(envs * sizeof(uint16_t));
+    int failed = chip8_env_reset(env, NULL, NULL, observations, probeValues);
+
+    uint64_t random = 0x9E3779B97F4A7C15;
+    double seconds = 0;
+    for (int step = 0; step < steps && failed == 0; step++) {
+        for (uint32_t i = 0; i < envs; i++) {
+            random ^= random >> 12;
+            random ^= random << 25;
+            random ^= random >> 27;
+            /* one key, or none, at a time. */
+            uint32_t key = (uint32_t) ((random * 0x2545F4914F6CDD1D) >> 59);
+            actions[i] = key < 16 ? (uint16_t) (1u << key) : 0;
+        }
+        double start = Now();
+        failed = chip8_env_step_batch(env, actions, observations, probeValues, rewards);
+        seconds += Now() - start;
+    }
+
+    if (failed != 0) {
+        printf("fail to step environments: %s\n", file);
+    } else {
+        printf("%s: %u environments, %.0f steps/s, %.0f frames/s\n", file, envs, steps * (double) envs / seconds,
+               steps * (double) envs * frames / seconds);
+    }
+
+    free(actions);
+    free(rewards);
+    free(probeValues);
+    free(observations);
+    chip8_env_destroy(env);
+    return failed != 0;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t envs = 256;
+    int steps = 2000;
+    uint32_t frames = 4;
+    int roms = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--envs=", 7) == 0 && atoi(argv[i] + 7) > 0) {
+            envs = (uint32_t) atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--steps=", 8) == 0 && atoi(argv[i] + 8) > 0) {
+            steps = atoi(argv[i] + 8);
+        } else if (strncmp(argv[i], "--frames=", 9) == 0 && atoi(argv[i] + 9) > 0) {
+            frames = (uint32_t) atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            printf("unknown argument: %s\n", argv[i]);
+            return 1;
+        } else {
+            roms++;
+        }
+    }
+    if (chip8_env_version() != CHIP8_ENV_VERSION) {
+        printf("chip8env version %u, built against %u\n", chip8_env_version(), CHIP8_ENV_VERSION);
+        return 1;
+    }
+
+    int failed = 0;
+    if (roms == 0) {
+        for (size_t i = 0; i < sizeof(bundled) / sizeof(bundled[0]); i++) {
+            char file[1024];
+            snprintf(file, sizeof(file), "%s/%s", CHIP8_ROM_DIR, bundled[i]);
+            failed |= Bench(file, envs, steps, frames);
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            failed |= Bench(argv[i], envs, steps, frames);
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,239 @@
+// chip8-explore: breadth-first search over the inputs of a ROM.
+//
+// usage: chip8-explore <rom> [--frames=N] [--ipf=N] [--depth=N] [--states=N] [--seed=N] [--keys=<hex digits>]
+//                     [--full-hash] [--verify]
+//
+// from the loaded ROM, every state is expanded with each input: no key, or
+// one of --keys (all 16 by default), held for --frames frames (10) then
+// released. states are told apart by Chip8Interpreter::IncrementalHash,
+// kept up to date by the stores instead of hashing the whole machine after
+// every input, and deduplicated in a StateSet; the frontier is kept as
+// CompactStates. the search stops after --depth inputs (32) or --states
+// states (1000000).
+//
+// reports the stuck states, where no input changes anything any more, with
+// the inputs leading to them, and the bytes of the ROM never executed.
+// --full-hash deduplicates by StateHash instead, to compare. --verify
+// checks the incremental memory hash against a full one after every input.
+
+#include <algorithm>
+#include <bitset>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chip8interpreter.h"
+#include "cli.h"
+#include "compactstate.h"
+#include "movie.h"
+#include "stateset.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int frames{10};
+    int cyclesPerFrame{10};
+    int depth{32};
+    size_t states{1000000};
+    uint64_t seed{0};
+    // keys of the inputs besides no key.
+    std::vector<int> keys;
+    bool fullHash{false};
+    bool verify{false};
+};
+
+struct Node {
+    CompactState state;
+    uint64_t memoryHash;
+    uint64_t key;
+    // index into parents and inputs.
+    uint32_t id;
+};
+
+static int Usage() {
+    std::cout << "usage: chip8-explore <rom> [--frames=N] [--ipf=N] [--depth=N] [--states=N] [--seed=N]"
+                 " [--keys=<hex digits>] [--full-hash] [--verify]" << std::endl;
+    return 1;
+}
+
+// '.' for no key.
+static char InputName(int input) {
+    return input < 0 ? '.' : "0123456789ABCDEF"[input];
+}
+
+// the inputs from the start to node id.
+static std::string Path(const std::vector<uint32_t> &parents, const std::vector<int8_t> &inputs, uint32_t id) {
+    std::string path;
+    for (; parents[id] != UINT32_MAX; id = parents[id]) {
+        path.insert(path.begin(), InputName(inputs[id]));
+    }
+    return path;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        return Usage();
+    }
+    std::string rom = argv[1];
+    Options options;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (arg.rfind("--frames=", 0) == 0) {
+            valid = ParseNumber(arg.substr(9), 1, options.frames);
+        } else if (arg.rfind("--ipf=", 0) == 0) {
+            valid = ParseNumber(arg.substr(6), 1, options.cyclesPerFrame);
+        } else if (arg.rfind("--depth=", 0) == 0) {
+            valid = ParseNumber(arg.substr(8), 1, options.depth);
+        } else if (arg.rfind("--states=", 0) == 0) {
+            valid = ParseNumber<size_t>(arg.substr(9), 1, options.states);
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            valid = ParseNumber<uint64_t>(arg.substr(7), 0, options.seed);
+        } else if (arg.rfind("--keys=", 0) == 0) {
+            valid = arg.size() > 7 && arg.find_first_not_of("0123456789abcdefABCDEF", 7) == std::string::npos;
+            for (size_t k = 7; valid && k < arg.size(); k++) {
+                int key = 0;
+                std::from_chars(&arg[k], &arg[k] + 1, key, 16);
+                options.keys.push_back(key);
+            }
+        } else if (arg == "--full-hash") {
+            options.fullHash = true;
+        } else if (arg == "--verify") {
+            options.verify = true;
+        } else {
+            std::cout << "unknown argument: " << arg << std::endl;
+            return Usage();
+        }
+        if (!valid) {
+            std::cout << "invalid argument: " << arg << std::endl;
+            return Usage();
+        }
+    }
+    if (options.keys.empty()) {
+        for (int key = 0; key < 16; key++) {
+            options.keys.push_back(key);
+        }
+    }
+    // -1: no key.
+    std::vector<int> inputs{-1};
+    inputs.insert(inputs.end(), options.keys.begin(), options.keys.end());
+
+    auto core = std::make_unique<Chip8Interpreter>();
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(rom, error);
+    if (error || !core->Load(rom)) {
+        std::cout << "fail to load rom: " << rom << std::endl;
+        return 1;
+    }
+    size_t romSize = std::min<uintmax_t>(fileSize, 0x1000 - 0x200);
+    core->Seed(options.seed);
+    core->cyclesPerFrame = options.cyclesPerFrame;
+    core->StartHashing();
+    auto hash = [&options](const Chip8Interpreter &machine) {
+        return options.fullHash ? StateHash(machine) : machine.IncrementalHash();
+    };
+
+    auto image = std::make_shared<const RomImage>(*core);
+    StateSet visited;
+    std::vector<uint32_t> parents{UINT32_MAX};
+    std::vector<int8_t> nodeInputs{-1};
+    std::vector<Node> frontier;
+    frontier.push_back({CompactState(image), core->memoryHash, hash(*core), 0});
+    frontier.back().state.Pack(*core);
+    visited.Insert(frontier.back().key);
+
+    std::bitset<0x1000> executed;
+    std::vector<uint32_t> stuck;
+    uint64_t ignoring = 0;
+    uint64_t expansions = 0;
+    auto parent = std::make_unique<Chip8Snapshot>();
+    auto start = Clock::now();
+
+    int depth = 0;
+    for (; depth < options.depth && !frontier.empty() && visited.Size() < options.states; depth++) {
+        std::vector<Node> next;
+        for (const Node &node: frontier) {
+            node.state.Unpack(parent->state);
+            bool same = true;
+            uint64_t first = 0;
+            for (size_t input = 0; input < inputs.size(); input++) {
+                core->LoadState(*parent, node.memoryHash);
+                core->INPUTS = inputs[input] < 0 ? 0 : 1 << inputs[input];
+                for (int frame = 0; frame < options.frames; frame++) {
+                    for (int cycle = 0; cycle < options.cyclesPerFrame; cycle++) {
+                        executed[core->PC & 0x0FFF] = true;
+                        executed[(core->PC + 1) & 0x0FFF] = true;
+                        core->Step(1);
+                    }
+                    core->TickTimers();
+                }
+                core->INPUTS = 0;
+                expansions++;
+
+                if (options.verify && core->memoryHash != core->HashMemory()) {
+                    std::cout << "incremental hash differs after " << Path(parents, nodeInputs, node.id)
+                              << InputName(inputs[input]) << std::endl;
+                    return 1;
+                }
+                uint64_t key = hash(*core);
+                same &= input == 0 || key == first;
+                first = input == 0 ? key : first;
+                if (visited.Size() < options.states && visited.Insert(key)) {
+                    next.push_back({CompactState(image), core->memoryHash, key, (uint32_t) parents.size()});
+                    next.back().state.Pack(*core);
+                    parents.push_back(node.id);
+                    nodeInputs.push_back((int8_t) inputs[input]);
+                }
+            }
+            if (same && first == node.key) {
+                stuck.push_back(node.id);
+            } else if (same) {
+                ignoring++;
+            }
+        }
+        frontier.swap(next);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "depth " << depth + 1 << ": " << frontier.size() << " new states, " << visited.Size()
+                  << " in all, " << seconds << " s" << std::endl;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    size_t frontierBytes = 0;
+    for (const Node &node: frontier) {
+        frontierBytes += node.state.Bytes();
+    }
+    std::cout << visited.Size() << " states to depth " << depth << ", " << expansions << " inputs in " << seconds
+              << " s (" << expansions / seconds << " inputs/s), visited set " << visited.Bytes() / 1024
+              << " KB, frontier " << frontierBytes / 1024 << " KB" << std::endl;
+    std::cout << ignoring << " states ignore every input, " << stuck.size() << " are stuck" << std::endl;
+    for (size_t i = 0; i < stuck.size() && i < 5; i++) {
+        std::cout << "  stuck after: " << Path(parents, nodeInputs, stuck[i]) << std::endl;
+    }
+
+    size_t never = 0;
+    int ranges = 0;
+    for (size_t address = 0x200; address < 0x200 + romSize; address++) {
+        if (executed[address]) {
+            continue;
+        }
+        size_t end = address;
+        while (end < 0x200 + romSize && !executed[end]) {
+            end++;
+        }
+        never += end - address;
+        if (ranges++ < 32) {
+            std::cout << "  never executed: " << std::hex << std::uppercase << std::setfill('0')
+                      << std::setw(3) << address << "-" << std::setw(3) << end - 1 << std::dec
+                      << " (" << end - address << " bytes)" << std::endl;
+        }
+        address = end;
+    }
+    std::cout << never << " of " << romSize << " bytes of the ROM never executed, code or data" << std::endl;
+    return 0;
+}
@@ -0,0 +1,370 @@
+#include "jit.h"
+
+#include <cstring>
+
+#ifdef CHIP8_JIT_AVAILABLE
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// x86 register numbers.
+const static uint8_t EAX = 0;
+const static uint8_t ECX = 1;
+const static uint8_t EDX = 2;
+
+// longest code a single instruction compiles to, an epilogue of its own included.
+const static size_t maxInstructionSize{64};
+// longest prologue, and the StorePC and epilogue closing a block that ran
+// into the end of RAM.
+const static size_t maxPrologueSize{16};
+const static size_t maxEndSize{16};
+
+Jit::Jit(const Chip8Interpreter &owner) {
+#ifdef _WIN32
+    code = static_cast<uint8_t *>(VirtualAlloc(nullptr, codeSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+#else
+    void *memory = mmap(nullptr, codeSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    code = memory == MAP_FAILED ? nullptr : static_cast<uint8_t *>(memory);
+#endif
+
+    auto base = reinterpret_cast<const char *>(&owner);
+    offsetV = reinterpret_cast<const char *>(&owner.V) - base;
+    offsetI = reinterpret_cast<const char *>(&owner.I) - base;
+    offsetPC = reinterpret_cast<const char *>(&owner.PC) - base;
+    offsetDT = reinterpret_cast<const char *>(&owner.DT) - base;
+    offsetST = reinterpret_cast<const char *>(&owner.ST) - base;
+}
+
+Jit::~Jit() {
+    if (code == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(code, 0, MEM_RELEASE);
+#else
+    munmap(code, codeSize);
+#endif
+}
+
+Jit::Function Jit::Compile(const Chip8Interpreter::Block &block) {
+    if (code == nullptr) {
+        return nullptr;
+    }
+
+    uint8_t *start = code + used;
+    uint8_t *limit = code + codeSize;
+    out = start;
+    if (limit - start < (ptrdiff_t) (maxPrologueSize + maxInstructionSize + maxEndSize)) {
+        return nullptr;
+    }
+
+    EmitPrologue();
+    uint16_t pc = block.start;
+    bool exited = false;
+    for (const auto &entry: block.code) {
+        if (limit - out < (ptrdiff_t) (maxInstructionSize + maxEndSize)) {
+            return nullptr;
+        }
+        Op op = Decode(entry.ins.opcode);
+        if (!EmitNative(entry, pc)) {
+            EmitFallback(entry, pc);
+        }
+        pc += 2;
+        exited = IsBlockTerminator(op);
+    }
+    if (!exited) {
+        // the block ran into the end of RAM.
+        StorePC(pc);
+    }
+    EmitEpilogue();
+
+    used = out - code;
+    return reinterpret_cast<Function>(start);
+}
+
+void Jit::Flush() {
+    used = 0;
+    fallbacks.clear();
+}
+
+void Jit::CallHandler(Chip8Interpreter *self, const Chip8Interpreter::DecodedInstruction *entry) {
+    (self->*entry->handler)(entry->ins);
+}
+
+void Jit::Emit8(uint8_t value) {
+    *out++ = value;
+}
+
+void Jit::Emit16(uint16_t value) {
+    std::memcpy(out, &value, sizeof(value));
+    out += sizeof(value);
+}
+
+void Jit::Emit32(uint32_t value) {
+    std::memcpy(out, &value, sizeof(value));
+    out += sizeof(value);
+}
+
+void Jit::Emit64(uint64_t value) {
+    std::memcpy(out, &value, sizeof(value));
+    out += sizeof(value);
+}
+
+void Jit::EmitMem(uint8_t opcode, uint8_t reg, int32_t offset) {
+    Emit8(opcode);
+    // mod = 10 (disp32), rm = 011 (rbx)
+    Emit8(0x80 | reg << 3 | 0x03);
+    Emit32(offset);
+}
+
+void Jit::EmitMem(uint8_t prefix, uint8_t opcode, uint8_t reg, int32_t offset) {
+    Emit8(prefix);
+    EmitMem(opcode, reg, offset);
+}
+
+void Jit::LoadByte(uint8_t reg, int32_t offset) {
+    // movzx reg, byte [rbx + offset]
+    EmitMem(0x0F, 0xB6, reg, offset);
+}
+
+void Jit::StoreByte(uint8_t reg, int32_t offset) {
+    // mov byte [rbx + offset], reg
+    EmitMem(0x88, reg, offset);
+}
+
+void Jit::StorePC(uint16_t pc) {
+    // mov word [rbx + PC], pc
+    EmitMem(0x66, 0xC7, 0, offsetPC);
+    Emit16(pc);
+}
+
+void Jit::EmitPrologue() {
+    // push rbx
+    Emit8(0x53);
+    // sub rsp, 32: keeps the stack aligned and is the win64 shadow space.
+    Emit8(0x48);
+    Emit8(0x83);
+    Emit8(0xEC);
+    Emit8(0x20);
+    // mov rbx, first argument
+    Emit8(0x48);
+    Emit8(0x89);
+#ifdef _WIN32
+    Emit8(0xCB);
+#else
+    Emit8(0xFB);
+#endif
+}
+
+void Jit::EmitEpilogue() {
+    // add rsp, 32
+    Emit8(0x48);
+    Emit8(0x83);
+    Emit8(0xC4);
+    Emit8(0x20);
+    // pop rbx
+    Emit8(0x5B);
+    // ret
+    Emit8(0xC3);
+}
+
+void Jit::EmitFallback(const Chip8Interpreter::DecodedInstruction &entry, uint16_t pc) {
+    fallbacks.push_back(entry);
+
+    // handlers move PC relative to the instruction.
+    StorePC(pc);
+    // mov first argument, rbx
+    Emit8(0x48);
+    Emit8(0x89);
+#ifdef _WIN32
+    Emit8(0xD9);
+#else
+    Emit8(0xDF);
+#endif
+    // mov second argument, imm64
+    Emit8(0x48);
+#ifdef _WIN32
+    Emit8(0xBA);
+#else
+    Emit8(0xBE);
+#endif
+    Emit64(reinterpret_cast<uint64_t>(&fallbacks.back()));
+    // mov rax, imm64; call rax
+    Emit8(0x48);
+    Emit8(0xB8);
+    Emit64(reinterpret_cast<uint64_t>(&Jit::CallHandler));
+    Emit8(0xFF);
+    Emit8(0xD0);
+
+    if (IsBlockTerminator(Decode(entry.ins.opcode))) {
+        EmitEpilogue();
+    }
+}
+
+bool Jit::EmitNative(const Chip8Interpreter::DecodedInstruction &entry, uint16_t pc) {
+    const Instruction &ins = entry.ins;
+    int32_t Vx = offsetV + ins.X;
+    int32_t Vy = offsetV + ins.Y;
+    int32_t VF = offsetV + 0x0F;
+
+    switch (Decode(ins.opcode)) {
+        case Op::JP_Addr:
+            StorePC(ins.NNN);
+            EmitEpilogue();
+            return true;
+        case Op::SE_Vx_Byte:
+        case Op::SNE_Vx_Byte:
+        case Op::SE_Vx_Vy:
+        case Op::SNE_Vx_Vy: {
+            Op op = Decode(ins.opcode);
+            LoadByte(EAX, Vx);
+            if (op == Op::SE_Vx_Byte || op == Op::SNE_Vx_Byte) {
+                // cmp al, KK
+                Emit8(0x3C);
+                Emit8(ins.KK);
+            } else {
+                // cmp al, byte [rbx + Vy]
+                EmitMem(0x3A, EAX, Vy);
+            }
+            StorePC(pc + 2);
+            // jne/je over the 9 byte store of the skip target
+            Emit8(op == Op::SE_Vx_Byte || op == Op::SE_Vx_Vy ? 0x75 : 0x74);
+            Emit8(9);
+            StorePC(pc + 4);
+            EmitEpilogue();
+            return true;
+        }
+        case Op::LD_Vx_Byte:
+            // mov byte [rbx + Vx], KK
+            EmitMem(0xC6, 0, Vx);
+            Emit8(ins.KK);
+            return true;
+        case Op::ADD_Vx_Byte:
+            // add byte [rbx + Vx], KK
+            EmitMem(0x80, 0, Vx);
+            Emit8(ins.KK);
+            return true;
+        case Op::LD_Vx_Vy:
+            LoadByte(EAX, Vy);
+            StoreByte(EAX, Vx);
+            return true;
+        case Op::OR_Vx_Vy:
+        case Op::AND_Vx_Vy:
+        case Op::XOR_Vx_Vy: {
+            Op op = Decode(ins.opcode);
+            LoadByte(EAX, Vx);
+            LoadByte(ECX, Vy);
+            // or/and/xor al, cl
+            Emit8(op == Op::OR_Vx_Vy ? 0x08 : op == Op::AND_Vx_Vy ? 0x20 : 0x30);
+            Emit8(0xC8);
+            StoreByte(EAX, Vx);
+            // mov byte [rbx + VF], 0
+            EmitMem(0xC6, 0, VF);
+            Emit8(0);
+            return true;
+        }
+        case Op::ADD_Vx_Vy:
+        case Op::SUB_Vx_Vy:
+        case Op::SUBN_Vx_Vy: {
+            // VF is written before the result, exactly like the handlers,
+            // so the result is computed again from the registers afterwards.
+            Op op = Decode(ins.opcode);
+            int32_t lhs = op == Op::SUBN_Vx_Vy ? Vy : Vx;
+            int32_t rhs = op == Op::SUBN_Vx_Vy ? Vx : Vy;
+            uint8_t alu = op == Op::ADD_Vx_Vy ? 0x00 : 0x28;
+            LoadByte(EAX, lhs);
+            LoadByte(ECX, rhs);
+            // add/sub al, cl
+            Emit8(alu);
+            Emit8(0xC8);
+            // setc dl for the carry, setnc dl for NOT borrow
+            Emit8(0x0F);
+            Emit8(op == Op::ADD_Vx_Vy ? 0x92 : 0x93);
+            Emit8(0xC2);
+            StoreByte(EDX, VF);
+            LoadByte(EAX, lhs);
+            LoadByte(ECX, rhs);
+            Emit8(alu);
+            Emit8(0xC8);
+            StoreByte(EAX, Vx);
+            return true;
+        }
+        case Op::SHR_Vx_iVy:
+            LoadByte(EAX, Vx);
+            // and al, 1
+            Emit8(0x24);
+            Emit8(0x01);
+            StoreByte(EAX, VF);
+            LoadByte(EAX, Vx);
+            // shr al, 1
+            Emit8(0xD0);
+            Emit8(0xE8);
+            StoreByte(EAX, Vx);
+            return true;
+        case Op::SHL_Vx_iVy:
+            LoadByte(EAX, Vx);
+            // shr al, 7
+            Emit8(0xC0);
+            Emit8(0xE8);
+            Emit8(0x07);
+            StoreByte(EAX, VF);
+            LoadByte(EAX, Vx);
+            // add al, al
+            Emit8(0x00);
+            Emit8(0xC0);
+            StoreByte(EAX, Vx);
+            return true;
+        case Op::LD_I_Addr:
+            // mov word [rbx + I], NNN
+            EmitMem(0x66, 0xC7, 0, offsetI);
+            Emit16(ins.NNN);
+            return true;
+        case Op::LD_Vx_DT:
+            LoadByte(EAX, offsetDT);
+            StoreByte(EAX, Vx);
+            return true;
+        case Op::LD_DT_Vx:
+            LoadByte(EAX, Vx);
+            StoreByte(EAX, offsetDT);
+            return true;
+        case Op::LD_ST_Vx:
+            LoadByte(EAX, Vx);
+            StoreByte(EAX, offsetST);
+            return true;
+        case Op::ADD_I_Vx:
+            LoadByte(ECX, Vx);
+            // add word [rbx + I], cx
+            EmitMem(0x66, 0x01, ECX, offsetI);
+            return true;
+        case Op::LD_F_Vx:
+            LoadByte(EAX, Vx);
+            // lea eax, [rax + rax * 4]
+            Emit8(0x8D);
+            Emit8(0x04);
+            Emit8(0x80);
+            // mov word [rbx + I], ax
+            EmitMem(0x66, 0x89, EAX, offsetI);
+            return true;
+        default:
+            return false;
+    }
+}
+
+#else
+
+Jit::Jit(const Chip8Interpreter &owner) {
+}
+
+Jit::~Jit() = default;
+
+Jit::Function Jit::Compile(const Chip8Interpreter::Block &block) {
+    return nullptr;
+}
+
+void Jit::Flush() {
+}
+
+#endif
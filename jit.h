@@ -0,0 +1,89 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+
+#include "chip8interpreter.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHIP8_JIT_AVAILABLE
+#endif
+
+// x86-64 recompiler for translated blocks.
+//
+// compiled code keeps the interpreter in rbx and works on V, I, DT and ST
+// in place. PC is known while compiling, so it is only written back when
+// the block exits or before an instruction falls back to its handler.
+// DRW, LD Vx, K, the stores and everything else without a native form
+// call back into the interpreter.
+class Jit {
+public:
+    using Function = void (*)(Chip8Interpreter *self);
+
+    // size of the executable code buffer.
+    const static size_t codeSize{1 << 20};
+
+    explicit Jit(const Chip8Interpreter &owner);
+
+    ~Jit();
+
+    Jit(const Jit &) = delete;
+
+    Jit &operator=(const Jit &) = delete;
+
+    // compile block, nullptr when the code buffer is full.
+    Function Compile(const Chip8Interpreter::Block &block);
+
+    // release every compiled block.
+    void Flush();
+
+private:
+    uint8_t *code{nullptr};
+    size_t used{0};
+    // instructions compiled as calls into their handler, referenced by the code.
+    std::deque<Chip8Interpreter::DecodedInstruction> fallbacks;
+
+    // member offsets from the Chip8Interpreter pointer.
+    int32_t offsetV;
+    int32_t offsetI;
+    int32_t offsetPC;
+    int32_t offsetDT;
+    int32_t offsetST;
+
+    // emission buffer of the block being compiled.
+    uint8_t *out{nullptr};
+
+    static void CallHandler(Chip8Interpreter *self, const Chip8Interpreter::DecodedInstruction *entry);
+
+    void Emit8(uint8_t value);
+
+    void Emit16(uint16_t value);
+
+    void Emit32(uint32_t value);
+
+    void Emit64(uint64_t value);
+
+    // opcode with a [rbx + offset] operand.
+    void EmitMem(uint8_t opcode, uint8_t reg, int32_t offset);
+
+    void EmitMem(uint8_t prefix, uint8_t opcode, uint8_t reg, int32_t offset);
+
+    void LoadByte(uint8_t reg, int32_t offset);
+
+    void StoreByte(uint8_t reg, int32_t offset);
+
+    void StorePC(uint16_t pc);
+
+    void EmitPrologue();
+
+    void EmitEpilogue();
+
+    void EmitFallback(const Chip8Interpreter::DecodedInstruction &entry, uint16_t pc);
+
+    // emit the native form of entry, false when it has none.
+    bool EmitNative(const Chip8Interpreter::DecodedInstruction &entry, uint16_t pc);
+};
+
+#endif // JIT_H
@@ -0,0 +1,46 @@
+#ifndef KEYPAD_H
+#define KEYPAD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// the 16 keys shared between the GUI thread and the emulation thread.
+//
+// the GUI sets and clears bits as keys go down and up, the emulation thread
+// reads the whole mask before every frame. neither side waits, and a key
+// lands in the next frame whatever the state of the emulation event loop.
+class Keypad {
+public:
+    void Press(int key) {
+        changed.store(Now(), std::memory_order_relaxed);
+        keys.fetch_or(1 << key, std::memory_order_release);
+    }
+
+    void Release(int key) {
+        changed.store(Now(), std::memory_order_relaxed);
+        keys.fetch_and(~(1 << key), std::memory_order_release);
+    }
+
+    // bit k set while key k is down.
+    uint16_t Keys() const {
+        return keys.load(std::memory_order_acquire);
+    }
+
+    // time of the last Press or Release, see Now.
+    int64_t ChangedAt() const {
+        return changed.load(std::memory_order_relaxed);
+    }
+
+    // steady clock in nanoseconds.
+    static int64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    std::atomic<uint16_t> keys{0};
+    std::atomic<int64_t> changed{0};
+};
+
+#endif // KEYPAD_H
@@ -0,0 +1,87 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// latencies of a session in 0.1ms buckets, for percentiles.
+class LatencyHistogram {
+public:
+    const static int bucketNanoseconds{100000};
+    // up to 200ms, the last bucket takes everything above.
+    const static int bucketCount{2000};
+
+    void Add(int64_t nanoseconds) {
+        int64_t bucket = nanoseconds / bucketNanoseconds;
+        if (bucket < 0) {
+            bucket = 0;
+        }
+        if (bucket > bucketCount) {
+            bucket = bucketCount;
+        }
+        buckets[bucket]++;
+        count++;
+    }
+
+    uint64_t Count() const {
+        return count;
+    }
+
+    // milliseconds under which fraction of the latencies fall, rounded up to a bucket.
+    double Percentile(double fraction) const {
+        if (count == 0) {
+            return 0;
+        }
+        uint64_t rank = (uint64_t) (fraction * (count - 1));
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket <= bucketCount; bucket++) {
+            seen += buckets[bucket];
+            if (seen > rank) {
+                return (bucket + 1) * bucketNanoseconds / 1e6;
+            }
+        }
+        return (bucketCount + 1) * bucketNanoseconds / 1e6;
+    }
+
+private:
+    std::array<uint64_t, bucketCount + 1> buckets{};
+    uint64_t count{0};
+};
+
+// key press to photon, split at the points a key passes through:
+//   input: key press until the frame that reads it, waiting for the frame timer.
+//   emulation: that frame until the first frame drawn after it is published.
+//   presentation: publish until paintEvent painted it, the queued frameReady and the repaint.
+struct LatencyProbe {
+    LatencyHistogram input;
+    LatencyHistogram emulation;
+    LatencyHistogram presentation;
+    LatencyHistogram total;
+
+    // times in Keypad::Now nanoseconds.
+    void Add(int64_t pressedAt, int64_t observedAt, int64_t publishedAt, int64_t presentedAt) {
+        input.Add(observedAt - pressedAt);
+        emulation.Add(publishedAt - observedAt);
+        presentation.Add(presentedAt - publishedAt);
+        total.Add(presentedAt - pressedAt);
+    }
+
+    std::string Report() const {
+        std::ostringstream out;
+        out << "latency of " << total.Count() << " key presses, p50 / p99 ms:\n";
+        Line(out, "input", input);
+        Line(out, "emulation", emulation);
+        Line(out, "presentation", presentation);
+        Line(out, "total", total);
+        return out.str();
+    }
+
+private:
+    static void Line(std::ostringstream &out, const char *name, const LatencyHistogram &histogram) {
+        out << "  " << name << ": " << histogram.Percentile(0.5) << " / " << histogram.Percentile(0.99) << "\n";
+    }
+};
+
+#endif // LATENCY_H
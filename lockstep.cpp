@@ -0,0 +1,525 @@
+#include "lockstep.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// lanes of a group: all of them, the index is the lane, so loops over
+// them are contiguous and vectorize.
+struct AllLanes {
+    size_t count;
+
+    size_t operator[](size_t i) const {
+        return i;
+    }
+};
+
+// lanes of a group: a list of them.
+struct LaneList {
+    const uint32_t *lanes;
+    size_t count;
+
+    size_t operator[](size_t i) const {
+        return lanes[i];
+    }
+};
+
+const static size_t ramSize{0x1000};
+
+Lockstep::Lockstep(size_t lanes) :
+        count{lanes},
+        V(16 * lanes),
+        DT(lanes),
+        ST(lanes),
+        I(lanes, 0x200),
+        PC(lanes, 0x200),
+        SP(lanes),
+        INPUTS(lanes),
+        RND(lanes),
+        STACK(lanes * Chip8State::stackSize),
+        RAM(lanes * ramSize),
+        BUFFER(lanes * Chip8State::screenHeight),
+        opcodes(lanes),
+        grouped(lanes),
+        stamp(0x10000),
+        groupOf(0x10000) {
+    size_t groups = std::min<size_t>(lanes, 0x10000);
+    groupOpcodes.reserve(groups);
+    groupEnds.reserve(groups);
+    groupNext.reserve(groups);
+    std::memcpy(image.data(), CHIP8FONTSET, sizeof(CHIP8FONTSET));
+    for (size_t lane = 0; lane < count; lane++) {
+        std::memcpy(&RAM[lane * ramSize], image.data(), ramSize);
+        Seed(lane, lane);
+    }
+}
+
+size_t Lockstep::Lanes() const {
+    return count;
+}
+
+bool Lockstep::Load(const std::string &file) {
+    std::ifstream stream(file, std::ios::binary | std::ios::in);
+    if (!stream.is_open()) {
+        return false;
+    }
+    std::vector<uint8_t> rom;
+    char c;
+    while (rom.size() < ramSize - 0x200 && stream.get(c)) {
+        rom.push_back(c);
+    }
+    Load(rom.data(), rom.size());
+    return true;
+}
+
+void Lockstep::Load(const uint8_t *rom, size_t size) {
+    size = std::min(size, ramSize - 0x200);
+    std::memcpy(&image[0x200], rom, size);
+    for (size_t address = 0x200; address < 0x200 + size; address++) {
+        written[address] = false;
+    }
+    for (size_t lane = 0; lane < count; lane++) {
+        std::memcpy(&RAM[lane * ramSize + 0x200], rom, size);
+        PC[lane] = 0x200;
+        I[lane] = 0x200;
+    }
+}
+
+void Lockstep::Seed(size_t lane, uint64_t seed) {
+    RND[lane] = RNDRegister(seed).state;
+}
+
+void Lockstep::KeyDown(size_t lane, int key) {
+    INPUTS[lane] |= 1 << key;
+}
+
+void Lockstep::KeyUp(size_t lane, int key) {
+    INPUTS[lane] &= ~(1 << key);
+}
+
+void Lockstep::SetKeys(size_t lane, uint16_t keys) {
+    INPUTS[lane] = keys;
+}
+
+uint8_t Lockstep::Register(size_t lane, int r) const {
+    return V[r * count + lane];
+}
+
+uint8_t Lockstep::Peek(size_t lane, uint16_t address) const {
+    return RAM[lane * ramSize + (address & 0x0FFF)];
+}
+
+size_t Lockstep::Regroup() {
+    // the stamp of a step never matches an older one, until it wraps.
+    if (++generation == 0) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        generation = 1;
+    }
+    groupOpcodes.clear();
+    groupEnds.clear();
+    for (size_t lane = 0; lane < count; lane++) {
+        uint16_t opcode = opcodes[lane];
+        if (stamp[opcode] != generation) {
+            stamp[opcode] = generation;
+            groupOf[opcode] = groupOpcodes.size();
+            groupOpcodes.push_back(opcode);
+            groupEnds.push_back(0);
+        }
+        groupEnds[groupOf[opcode]]++;
+    }
+    // counts -> ends, then place the lanes back to front.
+    for (size_t group = 1; group < groupEnds.size(); group++) {
+        groupEnds[group] += groupEnds[group - 1];
+    }
+    groupNext.assign(groupEnds.begin(), groupEnds.end());
+    for (size_t lane = count; lane-- > 0;) {
+        grouped[--groupNext[groupOf[opcodes[lane]]]] = lane;
+    }
+    return groupOpcodes.size();
+}
+
+bool Lockstep::Fetch() {
+    uint16_t first = PC[0];
+    bool samePC = true;
+    for (size_t lane = 0; lane < count; lane++) {
+        samePC &= PC[lane] == first;
+    }
+    if (samePC && !written[first & 0x0FFF] && !written[(first + 1) & 0x0FFF]) {
+        opcodes[0] = image[first & 0x0FFF] << 8 | image[(first + 1) & 0x0FFF];
+        return true;
+    }
+
+    bool converged = true;
+    for (size_t lane = 0; lane < count; lane++) {
+        const uint8_t *ram = &RAM[lane * ramSize];
+        uint16_t pc = PC[lane];
+        opcodes[lane] = ram[pc & 0x0FFF] << 8 | ram[(pc + 1) & 0x0FFF];
+        converged &= opcodes[lane] == opcodes[0];
+    }
+    return converged;
+}
+
+void Lockstep::Step(uint64_t cycles) {
+    for (uint64_t cycle = 0; cycle < cycles; cycle++) {
+        stats.steps++;
+        if (Fetch()) {
+            stats.converged++;
+            stats.groups++;
+            Execute(Decode(opcodes[0]), ParseInstruction(opcodes[0]), AllLanes{count});
+            continue;
+        }
+        size_t groups = Regroup();
+        stats.groups += groups;
+        uint32_t begin = 0;
+        for (size_t group = 0; group < groups; group++) {
+            uint16_t opcode = groupOpcodes[group];
+            Execute(Decode(opcode), ParseInstruction(opcode), LaneList{&grouped[begin], groupEnds[group] - begin});
+            begin = groupEnds[group];
+        }
+    }
+}
+
+void Lockstep::RunFrame() {
+    Step(cyclesPerFrame);
+    TickTimers();
+}
+
+void Lockstep::TickTimers() {
+    for (size_t lane = 0; lane < count; lane++) {
+        DT[lane] -= DT[lane] > 0;
+        ST[lane] = 0;
+    }
+}
+
+void Lockstep::GetState(size_t lane, Chip8State &state) const {
+    for (int r = 0; r < 16; r++) {
+        state.V[r] = V[r * count + lane];
+    }
+    state.DT = DT[lane];
+    state.ST = ST[lane];
+    state.I = I[lane];
+    state.PC = PC[lane];
+    state.SP = SP[lane];
+    std::memcpy(state.STACK.data(), &STACK[lane * Chip8State::stackSize], sizeof(state.STACK));
+    std::memcpy(state.RAM.data(), &RAM[lane * ramSize], sizeof(state.RAM));
+    state.INPUTS = INPUTS[lane];
+    std::memcpy(state.BUFFER.data(), Screen(lane), sizeof(state.BUFFER));
+    state.RND.state = RND[lane];
+}
+
+void Lockstep::SetState(size_t lane, const Chip8State &state) {
+    for (int r = 0; r < 16; r++) {
+        V[r * count + lane] = state.V[r];
+    }
+    DT[lane] = state.DT;
+    ST[lane] = state.ST;
+    I[lane] = state.I;
+    PC[lane] = state.PC;
+    SP[lane] = state.SP;
+    std::memcpy(&STACK[lane * Chip8State::stackSize], state.STACK.data(), sizeof(state.STACK));
+    std::memcpy(&RAM[lane * ramSize], state.RAM.data(), sizeof(state.RAM));
+    for (size_t address = 0; address < ramSize; address++) {
+        if (state.RAM[address] != image[address]) {
+            written[address] = true;
+        }
+    }
+    INPUTS[lane] = state.INPUTS;
+    std::memcpy(&BUFFER[lane * Chip8State::screenHeight], state.BUFFER.data(), sizeof(state.BUFFER));
+    RND[lane] = state.RND.state;
+}
+
+const uint64_t *Lockstep::Screen(size_t lane) const {
+    return &BUFFER[lane * Chip8State::screenHeight];
+}
+
+// the cases follow the Chip8Interpreter methods, including the order of
+// the writes to VF and Vx when x is F.
+template<typename LaneSet>
+void Lockstep::Execute(Op op, Instruction ins, LaneSet lanes) {
+    uint8_t *vx = &V[ins.X * count];
+    uint8_t *vy = &V[ins.Y * count];
+    uint8_t *vf = &V[0x0F * count];
+    uint16_t *pc = PC.data();
+    uint16_t *index = I.data();
+    switch (op) {
+        case Op::UNKNOWN:
+            break;
+        case Op::CLS:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                std::fill_n(&BUFFER[l * Chip8State::screenHeight], Chip8State::screenHeight, 0);
+                pc[l] += 2;
+            }
+            break;
+        case Op::RET:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                pc[l] = STACK[l * Chip8State::stackSize + --SP[l]] + 2;
+            }
+            break;
+        case Op::JP_Addr:
+            for (size_t i = 0; i < lanes.count; i++) {
+                pc[lanes[i]] = ins.NNN;
+            }
+            break;
+        case Op::CALL_Addr:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                STACK[l * Chip8State::stackSize + SP[l]++] = pc[l];
+                pc[l] = ins.NNN;
+            }
+            break;
+        case Op::SE_Vx_Byte:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                pc[l] += vx[l] == ins.KK ? 4 : 2;
+            }
+            break;
+        case Op::SNE_Vx_Byte:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                pc[l] += vx[l] != ins.KK ? 4 : 2;
+            }
+            break;
+        case Op::SE_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                pc[l] += vx[l] == vy[l] ? 4 : 2;
+            }
+            break;
+        case Op::LD_Vx_Byte:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vx[l] = ins.KK;
+                pc[l] += 2;
+            }
+            break;
+        case Op::ADD_Vx_Byte:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vx[l] += ins.KK;
+                pc[l] += 2;
+            }
+            break;
+        case Op::LD_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vx[l] = vy[l];
+                pc[l] += 2;
+            }
+            break;
+        case Op::OR_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vx[l] |= vy[l];
+                vf[l] = 0;
+                pc[l] += 2;
+            }
+            break;
+        case Op::AND_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vx[l] &= vy[l];
+                vf[l] = 0;
+                pc[l] += 2;
+            }
+            break;
+        case Op::XOR_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vx[l] ^= vy[l];
+                vf[l] = 0;
+                pc[l] += 2;
+            }
+            break;
+        case Op::ADD_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vf[l] = vx[l] > 0xFF - vy[l];
+                vx[l] += vy[l];
+                pc[l] += 2;
+            }
+            break;
+        case Op::SUB_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vf[l] = vx[l] >= vy[l];
+                vx[l] -= vy[l];
+                pc[l] += 2;
+            }
+            break;
+        case Op::SHR_Vx_iVy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vf[l] = vx[l] & 0x01;
+                vx[l] >>= 1;
+                pc[l] += 2;
+            }
+            break;
+        case Op::SUBN_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vf[l] = vx[l] <= vy[l];
+                vx[l] = vy[l] - vx[l];
+                pc[l] += 2;
+            }
+            break;
+        case Op::SHL_Vx_iVy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vf[l] = vx[l] >> 7;
+                vx[l] <<= 1;
+                pc[l] += 2;
+            }
+            break;
+        case Op::SNE_Vx_Vy:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                pc[l] += vx[l] != vy[l] ? 4 : 2;
+            }
+            break;
+        case Op::LD_I_Addr:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                index[l] = ins.NNN;
+                pc[l] += 2;
+            }
+            break;
+        case Op::JP_V0_Addr:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                pc[l] = V[l] + ins.NNN;
+            }
+            break;
+        case Op::RND_Vx_KK:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                RNDRegister rnd(0);
+                rnd.state = RND[l];
+                vx[l] = rnd.next() & ins.KK;
+                RND[l] = rnd.state;
+                pc[l] += 2;
+            }
+            break;
+        case Op::DRW_Vx_Vy_N:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                const uint8_t *ram = &RAM[l * ramSize];
+                uint64_t *screen = &BUFFER[l * Chip8State::screenHeight];
+                int startX = vx[l] % Chip8State::screenWidth;
+                int startY = vy[l];
+                uint8_t collision = 0;
+                for (int row = 0; row < ins.N; row++) {
+                    uint64_t spriteLine = (uint64_t) ram[(index[l] + row) & 0x0FFF] << 56;
+                    if (startX != 0) {
+                        spriteLine = spriteLine >> startX | spriteLine << (64 - startX);
+                    }
+                    uint64_t &line = screen[(startY + row) % Chip8State::screenHeight];
+                    collision |= (line & spriteLine) != 0;
+                    line ^= spriteLine;
+                }
+                vf[l] = collision;
+                pc[l] += 2;
+            }
+            break;
+        case Op::SKP_Vx:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                pc[l] += INPUTS[l] >> (vx[l] & 0xF) & 1 ? 4 : 2;
+            }
+            break;
+        case Op::SKNP_Vx:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                pc[l] += INPUTS[l] >> (vx[l] & 0xF) & 1 ? 2 : 4;
+            }
+            break;
+        case Op::LD_Vx_DT:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                vx[l] = DT[l];
+                pc[l] += 2;
+            }
+            break;
+        case Op::LD_Vx_K:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                if (INPUTS[l] == 0) {
+                    continue;
+                }
+                int key = 0;
+                while (!(INPUTS[l] >> key & 1)) {
+                    key++;
+                }
+                vx[l] = key;
+                pc[l] += 2;
+            }
+            break;
+        case Op::LD_DT_Vx:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                DT[l] = vx[l];
+                pc[l] += 2;
+            }
+            break;
+        case Op::LD_ST_Vx:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                ST[l] = vx[l];
+                pc[l] += 2;
+            }
+            break;
+        case Op::ADD_I_Vx:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                index[l] += vx[l];
+                pc[l] += 2;
+            }
+            break;
+        case Op::LD_F_Vx:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                index[l] = vx[l] * 0x5;
+                pc[l] += 2;
+            }
+            break;
+        case Op::LD_B_Vx:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                uint8_t *ram = &RAM[l * ramSize];
+                int value = vx[l];
+                for (int b = 0; b < 3; b++) {
+                    ram[(index[l] + b) & 0x0FFF] = value % 10;
+                    written[(index[l] + b) & 0x0FFF] = true;
+                    value /= 10;
+                }
+                pc[l] += 2;
+            }
+            break;
+        case Op::LD_I_Vx:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                uint8_t *ram = &RAM[l * ramSize];
+                for (int r = 0; r <= ins.X; r++) {
+                    ram[(index[l] + r) & 0x0FFF] = V[r * count + l];
+                    written[(index[l] + r) & 0x0FFF] = true;
+                }
+                index[l] += ins.X + 1;
+                pc[l] += 2;
+            }
+            break;
+        case Op::LD_Vx_I:
+            for (size_t i = 0; i < lanes.count; i++) {
+                size_t l = lanes[i];
+                const uint8_t *ram = &RAM[l * ramSize];
+                for (int r = 0; r <= ins.X; r++) {
+                    V[r * count + l] = ram[(index[l] + r) & 0x0FFF];
+                }
+                index[l] += ins.X + 1;
+                pc[l] += 2;
+            }
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,135 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chip8interpreter.h"
+
+// many machines running the same ROM, with their own seeds and keys.
+//
+// the registers, timers, stacks, memories and screens of all the machines
+// are kept as structure of arrays: register r of every lane is contiguous
+// in V, and so on. every lane executes one instruction per step: lanes
+// fetching the same opcode form a group and run it as one loop over the
+// group, so while they agree (the usual case for lanes of one ROM) each
+// instruction is a single loop over all lanes the compiler vectorizes.
+// lanes that diverge are regrouped by opcode at every step. while all the
+// lanes are at the same PC of code no lane wrote to, the opcode is fetched
+// once for all of them.
+//
+// the instructions behave as the Chip8Interpreter method of the same Op,
+// a lane ends a frame in the same state as a Chip8Interpreter given the
+// same seed and keys. memory accesses wrap at 4KB.
+class Lockstep {
+public:
+    struct Stats {
+        // instructions executed by every lane.
+        uint64_t steps;
+        // groups executed, lanes per group is lanes * steps / groups.
+        uint64_t groups;
+        // steps where all lanes ran the same opcode.
+        uint64_t converged;
+    };
+
+    // instructions executed by RunFrame.
+    int cyclesPerFrame{10};
+
+    Stats stats{};
+
+    // lanes freshly constructed, lane l seeded with l.
+    explicit Lockstep(size_t lanes);
+
+    size_t Lanes() const;
+
+    // load rom into every lane, as Chip8Interpreter::Load.
+    bool Load(const std::string &file);
+
+    void Load(const uint8_t *rom, size_t size);
+
+    void Seed(size_t lane, uint64_t seed);
+
+    void KeyDown(size_t lane, int key);
+
+    void KeyUp(size_t lane, int key);
+
+    // set the keys down on lane, bit k for key k.
+    void SetKeys(size_t lane, uint16_t keys);
+
+    uint8_t Register(size_t lane, int r) const;
+
+    uint8_t Peek(size_t lane, uint16_t address) const;
+
+    // execute cycles instructions on every lane.
+    void Step(uint64_t cycles);
+
+    // one frame on every lane: cyclesPerFrame instructions, then the timers.
+    void RunFrame();
+
+    void TickTimers();
+
+    // copy a lane out of or into the arrays, for hashing, snapshots and resets.
+    void GetState(size_t lane, Chip8State &state) const;
+
+    void SetState(size_t lane, const Chip8State &state);
+
+    // rows of the screen of lane, as Chip8State::BUFFER. the screens of
+    // all the lanes follow each other, from Screen(0) on.
+    const uint64_t *Screen(size_t lane) const;
+
+private:
+    size_t count;
+
+    // V[r * count + lane]
+    std::vector<uint8_t> V;
+    std::vector<uint8_t> DT;
+    std::vector<uint8_t> ST;
+    std::vector<uint16_t> I;
+    std::vector<uint16_t> PC;
+    std::vector<uint8_t> SP;
+    std::vector<uint16_t> INPUTS;
+    std::vector<uint64_t> RND;
+    // STACK[lane * stackSize + i]
+    std::vector<uint16_t> STACK;
+    // RAM[lane * 0x1000 + address]
+    std::vector<uint8_t> RAM;
+    // BUFFER[lane * screenHeight + row]
+    std::vector<uint64_t> BUFFER;
+
+    // RAM of every lane as loaded, equal in every lane but where written.
+    std::array<uint8_t, 0x1000> image{};
+    // addresses stored to in some lane since loading, a byte each: cheaper
+    // to set for every stored byte than a bit.
+    std::array<bool, 0x1000> written{};
+
+    // opcode fetched by every lane in the current step.
+    std::vector<uint16_t> opcodes;
+    // lanes sorted by group, see Regroup.
+    std::vector<uint32_t> grouped;
+    // opcode -> group, valid where stamp equals generation.
+    uint32_t generation{0};
+    std::vector<uint32_t> stamp;
+    std::vector<uint32_t> groupOf;
+    // opcode and end in grouped of every group.
+    std::vector<uint16_t> groupOpcodes;
+    std::vector<uint32_t> groupEnds;
+    // next place in grouped of every group, while Regroup places the lanes.
+    // these three are reserved for the most groups there can be, so Step
+    // doesn't allocate.
+    std::vector<uint32_t> groupNext;
+
+    // fetch the opcode of every lane, returns true when they all fetched the same.
+    bool Fetch();
+
+    // split the lanes by opcode, returns the number of groups.
+    size_t Regroup();
+
+    // execute the instruction on the lanes, every lane or a list of them.
+    template<typename LaneSet>
+    void Execute(Op op, Instruction ins, LaneSet lanes);
+};
+
+#endif // LOCKSTEP_H
@@ -1,10 +1,50 @@
 #include "app.h"
+#include "cli.h"
 
 #include <QApplication>
+#include <iostream>
 
 int main(int argc, char *argv[]) {
     QApplication a(argc, argv);
-    App app;
+
+    // --engine=interpreter|block|jit|aot
+    // --ipf=<instructions per frame>
+    // --turbo
+    // --rewind-kb=<memory kept for rewinding, 0 to disable>
+    // --record=<movie file>
+    // --run-ahead=<frames>
+    // --profile=<file the profile is saved to, in a CHIP8_PROFILE build>
+    // --trace[=<instructions kept>]
+    // --trace-file=<file the trace is saved to>
+    EmulatorOptions options;
+    for (const QString &arg: QApplication::arguments().mid(1)) {
+        if (ParseEngine(arg.toStdString(), options.engine)) {
+        } else if (arg.startsWith("--ipf=") && arg.mid(6).toInt() > 0) {
+            options.cyclesPerFrame = arg.mid(6).toInt();
+        } else if (arg == "--turbo") {
+            options.turbo = true;
+        } else if (arg.startsWith("--rewind-kb=") && arg.mid(12).toInt() >= 0) {
+            options.rewindBytes = (size_t) arg.mid(12).toInt() * 1024;
+        } else if (arg.startsWith("--run-ahead=") && arg.mid(12).toInt() >= 0) {
+            options.runAhead = arg.mid(12).toInt();
+        } else if (arg.startsWith("--profile=") && arg.size() > 10) {
+            options.profile = arg.mid(10).toStdString();
+        } else if (arg == "--trace") {
+            options.trace = true;
+        } else if (arg.startsWith("--trace=") && arg.mid(8).toInt() > 0) {
+            options.trace = true;
+            options.traceRecords = arg.mid(8).toInt();
+        } else if (arg.startsWith("--trace-file=") && arg.size() > 13) {
+            options.traceFile = arg.mid(13).toStdString();
+        } else if (arg.startsWith("--record=") && arg.size() > 9) {
+            options.record = arg.mid(9).toStdString();
+        } else {
+            std::cout << "unknown argument: " << arg.toStdString() << std::endl;
+            return 1;
+        }
+    }
+
+    App app(options);
     app.show();
     return QApplication::exec();
 }
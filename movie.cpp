@@ -0,0 +1,131 @@
+#include "movie.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+// one multiply per word, good enough to tell two states apart.
+static uint64_t Mix(uint64_t hash, uint64_t value) {
+    hash ^= value;
+    hash *= 0x9E3779B97F4A7C15;
+    return hash ^ (hash >> 32);
+}
+
+static uint64_t MixBytes(uint64_t hash, const void *data, size_t size) {
+    auto bytes = static_cast<const uint8_t *>(data);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = Mix(hash, word);
+    }
+    for (; i < size; i++) {
+        hash = Mix(hash, bytes[i]);
+    }
+    return hash;
+}
+
+uint64_t StateHash(const Chip8State &state) {
+    uint64_t hash = 0xCBF29CE484222325;
+    hash = MixBytes(hash, state.V.data(), sizeof(state.V));
+    hash = Mix(hash, state.DT | state.ST << 8 | state.SP << 16);
+    hash = Mix(hash, state.I | state.PC << 16 | (uint64_t) state.INPUTS << 32);
+    hash = MixBytes(hash, state.STACK.data(), sizeof(state.STACK));
+    hash = MixBytes(hash, state.RAM.data(), sizeof(state.RAM));
+    hash = MixBytes(hash, state.BUFFER.data(), sizeof(state.BUFFER));
+    return Mix(hash, state.RND.state);
+}
+
+void Movie::Start(Chip8Interpreter &core) const {
+    core.Seed(seed);
+    core.cyclesPerFrame = cyclesPerFrame;
+}
+
+size_t Movie::ApplyEvents(Chip8Interpreter &core, uint64_t frame, size_t next) const {
+    for (; next < events.size() && events[next].frame == frame; next++) {
+        if (events[next].down) {
+            core.KeyDown(events[next].key);
+        } else {
+            core.KeyUp(events[next].key);
+        }
+    }
+    return next;
+}
+
+void Movie::RecordKey(int key, bool down) {
+    events.push_back({hashes.size(), (uint8_t) key, down});
+}
+
+void Movie::RecordFrame(const Chip8Interpreter &core) {
+    hashes.push_back(StateHash(core));
+}
+
+bool Movie::Save(const std::string &file) const {
+    std::ofstream stream(file, std::ios::out | std::ios::trunc);
+    if (!stream.is_open()) {
+        return false;
+    }
+    stream << "chip8-movie " << version << "\n";
+    stream << "seed " << seed << "\n";
+    stream << "ipf " << cyclesPerFrame << "\n";
+    for (const Event &event: events) {
+        stream << (event.down ? "down " : "up ") << event.frame << " " << (int) event.key << "\n";
+    }
+    stream << std::hex << std::setfill('0');
+    for (uint64_t hash: hashes) {
+        stream << "hash " << std::setw(16) << hash << "\n";
+    }
+    return stream.good();
+}
+
+bool Movie::Load(const std::string &file) {
+    std::ifstream stream(file, std::ios::in);
+    if (!stream.is_open()) {
+        return false;
+    }
+    std::string tag;
+    int fileVersion = 0;
+    if (!(stream >> tag >> fileVersion) || tag != "chip8-movie" || fileVersion != version) {
+        return false;
+    }
+    events.clear();
+    hashes.clear();
+    while (stream >> tag) {
+        if (tag == "seed") {
+            stream >> seed;
+        } else if (tag == "ipf") {
+            stream >> cyclesPerFrame;
+        } else if (tag == "down" || tag == "up") {
+            uint64_t frame;
+            int key;
+            stream >> frame >> key;
+            if (key < 0 || key > 0xF || (!events.empty() && frame < events.back().frame)) {
+                return false;
+            }
+            events.push_back({frame, (uint8_t) key, tag == "down"});
+        } else if (tag == "hash") {
+            uint64_t hash;
+            stream >> std::hex >> hash >> std::dec;
+            hashes.push_back(hash);
+        } else {
+            return false;
+        }
+        if (stream.fail()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int64_t Replay(Chip8Interpreter &core, const Movie &movie) {
+    movie.Start(core);
+    size_t next = 0;
+    for (size_t frame = 0; frame < movie.hashes.size(); frame++) {
+        next = movie.ApplyEvents(core, frame, next);
+        core.RunFrame();
+        if (StateHash(core) != movie.hashes[frame]) {
+            return (int64_t) frame;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,66 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chip8interpreter.h"
+
+// hash of every field of state, padding excluded.
+uint64_t StateHash(const Chip8State &state);
+
+// a recorded run: the key events by frame, and what else the run depends on.
+//
+// a run is reproduced by loading the same ROM, calling Start, then before
+// every frame applying its key events. the state hash after every frame is
+// kept to verify a replay.
+//
+// file format, text:
+//   chip8-movie 1
+//   seed <seed>
+//   ipf <cycles per frame>
+//   down <frame> <key>
+//   up <frame> <key>
+//   hash <hex>            one per frame, in order
+class Movie {
+public:
+    const static int version{1};
+
+    struct Event {
+        // frame the event happens before.
+        uint64_t frame;
+        uint8_t key;
+        bool down;
+    };
+
+    uint64_t seed{0};
+    int cyclesPerFrame{10};
+    // in frame order.
+    std::vector<Event> events;
+    // StateHash after every frame.
+    std::vector<uint64_t> hashes;
+
+    // seed core and set its cycles per frame, on a freshly loaded core.
+    void Start(Chip8Interpreter &core) const;
+
+    // apply the key events before frame, from events[next] on.
+    // returns the index of the first event of a later frame.
+    size_t ApplyEvents(Chip8Interpreter &core, uint64_t frame, size_t next) const;
+
+    // record a key event before the next frame.
+    void RecordKey(int key, bool down);
+
+    // record the state after a frame.
+    void RecordFrame(const Chip8Interpreter &core);
+
+    bool Save(const std::string &file) const;
+
+    bool Load(const std::string &file);
+};
+
+// replay movie on core, freshly loaded with its ROM.
+// returns the first frame whose state hash differs, -1 when every frame matches.
+int64_t Replay(Chip8Interpreter &core, const Movie &movie);
+
+#endif // MOVIE_H
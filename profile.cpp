@@ -0,0 +1,70 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+void Profile::Reset() {
+    *this = Profile{};
+}
+
+static void WriteTiming(std::ostream &out, const char *name, const Profile::Timing &timing) {
+    out << "  \"" << name << "\": {\"count\": " << timing.count << ", \"nanoseconds\": " << timing.nanoseconds << "},\n";
+}
+
+void Profile::Write(std::ostream &out) const {
+    uint64_t instructions = 0;
+    for (uint64_t count: families) {
+        instructions += count;
+    }
+
+    out << "{\n";
+    out << "  \"instructions\": " << instructions << ",\n";
+    out << "  \"idleInstructions\": " << idleInstructions << ",\n";
+
+    out << "  \"families\": {";
+    for (size_t family = 0; family < families.size(); family++) {
+        out << (family > 0 ? ", " : "") << "\"" << "0123456789ABCDEF"[family] << "\": " << families[family];
+    }
+    out << "},\n";
+
+    out << "  \"ops\": {";
+    bool first = true;
+    for (size_t op = 0; op < ops.size(); op++) {
+        if (ops[op] == 0) {
+            continue;
+        }
+        out << (first ? "" : ", ") << "\"" << OpName((Op) op) << "\": " << ops[op];
+        first = false;
+    }
+    out << "},\n";
+
+    WriteTiming(out, "draw", draw);
+    WriteTiming(out, "frame", frame);
+    WriteTiming(out, "present", present);
+
+    std::vector<uint16_t> addresses;
+    for (size_t address = 0; address < pcHits.size(); address++) {
+        if (pcHits[address] > 0) {
+            addresses.push_back((uint16_t) address);
+        }
+    }
+    std::stable_sort(addresses.begin(), addresses.end(), [this](uint16_t a, uint16_t b) {
+        return pcHits[a] > pcHits[b];
+    });
+    out << "  \"pcHits\": [";
+    for (size_t i = 0; i < addresses.size(); i++) {
+        out << (i > 0 ? ",\n    " : "\n    ") << "{\"pc\": " << addresses[i] << ", \"hits\": " << pcHits[addresses[i]] << "}";
+    }
+    out << (addresses.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+}
+
+bool Profile::Save(const std::string &file) const {
+    std::ofstream stream(file, std::ios::out | std::ios::trunc);
+    if (!stream.is_open()) {
+        return false;
+    }
+    Write(stream);
+    return stream.good();
+}
@@ -0,0 +1,66 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "decoder.h"
+
+// what the core spends its time on. collected only when built with
+// CHIP8_PROFILE, otherwise nothing calls into it.
+class Profile {
+public:
+    struct Timing {
+        uint64_t count;
+        uint64_t nanoseconds;
+    };
+
+    // adds the time of its scope to a Timing.
+    class Scope {
+    public:
+        explicit Scope(Timing &timing) : timing{timing}, start{std::chrono::steady_clock::now()} {
+        }
+
+        ~Scope() {
+            timing.count++;
+            timing.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        Timing &timing;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // executions by the first nibble of the opcode, the families of functionMap.
+    std::array<uint64_t, 16> families{};
+    // executions by decoded instruction.
+    std::array<uint64_t, (size_t) Op::COUNT> ops{};
+    // executions by address.
+    std::array<uint64_t, 0x1000> pcHits{};
+    // instructions skipped in idle loops, not counted above.
+    uint64_t idleInstructions{0};
+
+    Timing draw{};
+    Timing frame{};
+    // publishing frames to the frontend, timed by the frontend.
+    Timing present{};
+
+    void Count(Op op, uint16_t opcode, uint16_t pc) {
+        families[opcode >> 12]++;
+        ops[(size_t) op]++;
+        pcHits[pc & 0x0FFF]++;
+    }
+
+    void Reset();
+
+    // as JSON, addresses hottest first.
+    void Write(std::ostream &out) const;
+
+    bool Save(const std::string &file) const;
+};
+
+#endif // PROFILE_H
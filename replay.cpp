@@ -0,0 +1,129 @@
+// chip8-replay: run a movie headless and uncapped, verifying every frame.
+//
+// usage: chip8-replay <rom> <movie> [--engine=interpreter|block|jit|aot] [--repeat=N] [--rehash] [--profile=<file>]
+//                    [--trace=<file>]
+//
+// exits with 1 at the first frame whose state hash differs from the movie.
+// --rehash replays the key events and writes the new hashes into the movie
+// instead, after an intended change of behavior. --profile saves the
+// profile of the last repetition, in a CHIP8_PROFILE build. --trace saves
+// the last instructions of the last repetition, or up to the differing frame.
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "chip8interpreter.h"
+#include "cli.h"
+#include "movie.h"
+
+using Clock = std::chrono::steady_clock;
+
+static int Usage() {
+    std::cout << "usage: chip8-replay <rom> <movie> [--engine=interpreter|block|jit|aot] [--repeat=N] [--rehash]"
+                 " [--profile=<file>] [--trace=<file>]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        return Usage();
+    }
+    std::string rom = argv[1];
+    std::string file = argv[2];
+    Engine engine = Engine::Interpreter;
+    int repeat = 1;
+    bool rehash = false;
+    std::string profile;
+    std::string trace;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (ParseEngine(arg, engine)) {
+        } else if (arg.rfind("--repeat=", 0) == 0) {
+            if (!ParseNumber(arg.substr(9), 1, repeat)) {
+                std::cout << "invalid argument: " << arg << std::endl;
+                return Usage();
+            }
+        } else if (arg == "--rehash") {
+            rehash = true;
+        } else if (arg.rfind("--trace=", 0) == 0 && arg.size() > 8) {
+            trace = arg.substr(8);
+        } else if (arg.rfind("--profile=", 0) == 0 && arg.size() > 10) {
+            profile = arg.substr(10);
+        } else {
+            std::cout << "unknown argument: " << arg << std::endl;
+            return Usage();
+        }
+    }
+
+    Movie movie;
+    if (!movie.Load(file)) {
+        std::cout << "fail to load movie: " << file << std::endl;
+        return 1;
+    }
+
+    if (rehash) {
+        auto core = std::make_unique<Chip8Interpreter>();
+        if (!core->Load(rom)) {
+            std::cout << "fail to load rom: " << rom << std::endl;
+            return 1;
+        }
+        core->engine = engine;
+        Movie recorded = movie;
+        recorded.hashes.clear();
+        recorded.Start(*core);
+        size_t next = 0;
+        for (size_t frame = 0; frame < movie.hashes.size(); frame++) {
+            next = movie.ApplyEvents(*core, frame, next);
+            core->RunFrame();
+            recorded.RecordFrame(*core);
+        }
+        if (!recorded.Save(file)) {
+            std::cout << "fail to save movie: " << file << std::endl;
+            return 1;
+        }
+        std::cout << "rehashed " << recorded.hashes.size() << " frames." << std::endl;
+        return 0;
+    }
+
+    double seconds = 0;
+    for (int i = 0; i < repeat; i++) {
+        auto core = std::make_unique<Chip8Interpreter>();
+        if (!core->Load(rom)) {
+            std::cout << "fail to load rom: " << rom << std::endl;
+            return 1;
+        }
+        core->engine = engine;
+        if (!trace.empty()) {
+            core->StartTrace(1 << 16);
+        }
+        auto start = Clock::now();
+        int64_t mismatch = Replay(*core, movie);
+        seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        if (core->tracing && !core->Trace()->Save(trace)) {
+            std::cout << "fail to save trace: " << trace << std::endl;
+            return 1;
+        }
+        if (mismatch >= 0) {
+            std::cout << "state differs at frame " << mismatch << " of " << movie.hashes.size() << "." << std::endl;
+            return 1;
+        }
+        if (i == repeat - 1 && !profile.empty()) {
+#ifdef CHIP8_PROFILE
+            if (!core->profile.Save(profile)) {
+                std::cout << "fail to save profile: " << profile << std::endl;
+                return 1;
+            }
+#else
+            std::cout << "built without CHIP8_PROFILE, no profile to save." << std::endl;
+#endif
+        }
+    }
+
+    double frames = (double) movie.hashes.size() * repeat;
+    std::cout << movie.hashes.size() << " frames match, " << frames / seconds << " frames/s, "
+              << frames / seconds / Chip8Interpreter::frameRate << "x real time." << std::endl;
+    return 0;
+}
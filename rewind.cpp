@@ -0,0 +1,194 @@
+#include "rewind.h"
+
+#include <cstring>
+#include <utility>
+
+// an encoded frame is a sequence of runs: a uint16_t count of unchanged
+// (zero) bytes, a uint16_t count of literal bytes, then the literal bytes.
+static_assert(sizeof(Chip8Snapshot) <= 0xFFFF, "run lengths are 16-bit");
+
+Rewind::Rewind(size_t budget)
+        : ring(budget), latest{std::make_unique<Chip8Snapshot>()}, scratch{std::make_unique<Chip8Snapshot>()} {
+    encoded.reserve(sizeof(Chip8Snapshot) * 2);
+}
+
+void Rewind::Push(const Chip8Interpreter &core) {
+    if (ring.empty()) {
+        return;
+    }
+    auto previous = reinterpret_cast<const uint8_t *>(latest.get());
+    auto current = reinterpret_cast<const uint8_t *>(scratch.get());
+    core.SaveState(*scratch);
+
+    bool keyframe = entries.empty() || sinceKeyframe + 1 >= keyframeInterval;
+    Encode(current, keyframe ? nullptr : previous, sizeof(Chip8Snapshot));
+    size_t offset;
+    if (!Allocate(encoded.size(), offset)) {
+        Clear();
+        return;
+    }
+    if (!keyframe && entries.empty()) {
+        // the ring only had room by dropping the keyframe of this delta.
+        keyframe = true;
+        Encode(current, nullptr, sizeof(Chip8Snapshot));
+        if (!Allocate(encoded.size(), offset)) {
+            Clear();
+            return;
+        }
+    }
+
+    std::memcpy(&ring[offset], encoded.data(), encoded.size());
+    entries.push_back({offset, encoded.size(), keyframe});
+    head = offset + encoded.size();
+    used += encoded.size();
+    sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+    std::swap(latest, scratch);
+}
+
+bool Rewind::StepBack(Chip8Interpreter &core) {
+    if (entries.size() < 2) {
+        return false;
+    }
+    auto state = reinterpret_cast<uint8_t *>(latest.get());
+    Entry newest = entries.back();
+    entries.pop_back();
+    if (!newest.keyframe) {
+        // XOR with the delta gives back the frame before.
+        Decode(newest, state);
+        sinceKeyframe--;
+    } else {
+        // rebuild the frame before from its keyframe.
+        size_t keyframe = entries.size() - 1;
+        while (!entries[keyframe].keyframe) {
+            keyframe--;
+        }
+        for (size_t i = keyframe; i < entries.size(); i++) {
+            Decode(entries[i], state);
+        }
+        sinceKeyframe = (int) (entries.size() - 1 - keyframe);
+    }
+    // the newest frame is always the last one written.
+    head = newest.offset;
+    used -= newest.size;
+
+    core.LoadState(*latest);
+    return true;
+}
+
+void Rewind::Clear() {
+    entries.clear();
+    head = 0;
+    used = 0;
+    sinceKeyframe = 0;
+}
+
+size_t Rewind::Budget() const {
+    return ring.size();
+}
+
+size_t Rewind::Used() const {
+    return used;
+}
+
+size_t Rewind::Frames() const {
+    return entries.empty() ? 0 : entries.size() - 1;
+}
+
+bool Rewind::Allocate(size_t size, size_t &offset) {
+    if (size > ring.size()) {
+        return false;
+    }
+    while (!entries.empty()) {
+        size_t tail = entries.front().offset;
+        if (head >= tail) {
+            // live frames in [tail, head): room after head, or before tail.
+            if (head + size <= ring.size()) {
+                offset = head;
+                return true;
+            }
+            // strictly before tail, head == tail means empty.
+            if (size < tail) {
+                offset = 0;
+                return true;
+            }
+        } else if (head + size < tail) {
+            // live frames in [tail, end) and [0, head).
+            offset = head;
+            return true;
+        }
+        DropOldest();
+    }
+    head = 0;
+    offset = 0;
+    return true;
+}
+
+void Rewind::DropOldest() {
+    do {
+        used -= entries.front().size;
+        entries.pop_front();
+    } while (!entries.empty() && !entries.front().keyframe);
+    if (entries.empty()) {
+        head = 0;
+        sinceKeyframe = 0;
+    }
+}
+
+void Rewind::Encode(const uint8_t *data, const uint8_t *previous, size_t size) {
+    encoded.clear();
+    size_t i = 0;
+    while (i < size) {
+        size_t zeros = i;
+        while (zeros < size && (data[zeros] ^ (previous ? previous[zeros] : 0)) == 0) {
+            zeros++;
+        }
+        // literals end at the first run of more than 4 zero bytes, a shorter
+        // run costs less inline than as a new run header.
+        size_t end = zeros;
+        size_t last = zeros;
+        while (end < size && end - last <= 4) {
+            if ((data[end] ^ (previous ? previous[end] : 0)) != 0) {
+                last = end + 1;
+            }
+            end++;
+        }
+        if (last < zeros) {
+            last = zeros;
+        }
+
+        uint16_t zeroCount = zeros - i;
+        uint16_t literalCount = last - zeros;
+        encoded.push_back(zeroCount & 0xFF);
+        encoded.push_back(zeroCount >> 8);
+        encoded.push_back(literalCount & 0xFF);
+        encoded.push_back(literalCount >> 8);
+        for (size_t j = zeros; j < last; j++) {
+            encoded.push_back(data[j] ^ (previous ? previous[j] : 0));
+        }
+        i = last;
+    }
+}
+
+void Rewind::Decode(const Entry &entry, uint8_t *out) const {
+    const uint8_t *in = &ring[entry.offset];
+    const uint8_t *end = in + entry.size;
+    size_t position = 0;
+    while (in < end) {
+        size_t zeroCount = in[0] | in[1] << 8;
+        size_t literalCount = in[2] | in[3] << 8;
+        in += 4;
+        if (entry.keyframe) {
+            std::memset(out + position, 0, zeroCount);
+        }
+        position += zeroCount;
+        if (entry.keyframe) {
+            std::memcpy(out + position, in, literalCount);
+        } else {
+            for (size_t i = 0; i < literalCount; i++) {
+                out[position + i] ^= in[i];
+            }
+        }
+        position += literalCount;
+        in += literalCount;
+    }
+}
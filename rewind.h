@@ -0,0 +1,82 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "chip8interpreter.h"
+
+// the last frames of a machine in a fixed-size ring, to step back through them.
+//
+// every keyframeInterval-th frame is stored whole, the frames in between as the
+// XOR with the frame before. both are run-length encoded: unchanged bytes XOR
+// to zero, so a frame usually takes a few dozen bytes. stepping back over a
+// delta is one XOR with the newest frame; stepping back over a keyframe decodes
+// the keyframe before it and its deltas forward. when the ring is full the
+// oldest keyframe is dropped with its deltas.
+class Rewind {
+public:
+    // frames between keyframes.
+    const static int keyframeInterval{60};
+
+    // budget: bytes of the ring. a budget that can't hold one keyframe stores nothing.
+    explicit Rewind(size_t budget);
+
+    // record the machine after a frame.
+    void Push(const Chip8Interpreter &core);
+
+    // restore the frame before the newest one into core and drop the newest,
+    // false when there is none.
+    bool StepBack(Chip8Interpreter &core);
+
+    // drop every frame.
+    void Clear();
+
+    size_t Budget() const;
+
+    // bytes of the ring holding frames.
+    size_t Used() const;
+
+    // frames that can be stepped back.
+    size_t Frames() const;
+
+private:
+    struct Entry {
+        // in ring
+        size_t offset;
+        size_t size;
+        bool keyframe;
+    };
+
+    std::vector<uint8_t> ring;
+    // next free byte of ring.
+    size_t head{0};
+    size_t used{0};
+    // oldest first.
+    std::deque<Entry> entries;
+    // frames since the newest keyframe.
+    int sinceKeyframe{0};
+
+    // the newest frame, and scratch for encoding and decoding.
+    std::unique_ptr<Chip8Snapshot> latest;
+    std::unique_ptr<Chip8Snapshot> scratch;
+    std::vector<uint8_t> encoded;
+
+    // offset in ring for size bytes, dropping the oldest frames as needed.
+    // false when size doesn't fit in the ring at all.
+    bool Allocate(size_t size, size_t &offset);
+
+    // drop the oldest keyframe and its deltas.
+    void DropOldest();
+
+    // run-length encode data XOR previous into encoded, data itself when previous is nullptr.
+    void Encode(const uint8_t *data, const uint8_t *previous, size_t size);
+
+    // XOR (or copy, for a keyframe) the frame of entry into out.
+    void Decode(const Entry &entry, uint8_t *out) const;
+};
+
+#endif // REWIND_H
@@ -0,0 +1,87 @@
+#ifndef STATESET_H
+#define STATESET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// set of 64-bit state hashes, open addressing with linear probing.
+//
+// a slot is the hash itself, 0 marks an empty slot (a hash of 0 is stored
+// as 1). the table doubles past 70% load, 8 bytes a slot.
+class StateSet {
+public:
+    explicit StateSet(size_t capacity = 1024) {
+        size_t size = 16;
+        while (size * 7 < capacity * 10) {
+            size <<= 1;
+        }
+        slots.resize(size);
+    }
+
+    // false when hash was already in.
+    bool Insert(uint64_t hash) {
+        if ((count + 1) * 10 > slots.size() * 7) {
+            Grow();
+        }
+        hash = hash == 0 ? 1 : hash;
+        size_t mask = slots.size() - 1;
+        for (size_t slot = Home(hash); ; slot = (slot + 1) & mask) {
+            if (slots[slot] == hash) {
+                return false;
+            }
+            if (slots[slot] == 0) {
+                slots[slot] = hash;
+                count++;
+                return true;
+            }
+        }
+    }
+
+    bool Contains(uint64_t hash) const {
+        hash = hash == 0 ? 1 : hash;
+        size_t mask = slots.size() - 1;
+        for (size_t slot = Home(hash); slots[slot] != 0; slot = (slot + 1) & mask) {
+            if (slots[slot] == hash) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t Size() const {
+        return count;
+    }
+
+    size_t Bytes() const {
+        return slots.size() * sizeof(uint64_t);
+    }
+
+private:
+    std::vector<uint64_t> slots;
+    size_t count{0};
+
+    // multiplied again so that sequential hashes spread, the upper half picks the slot.
+    size_t Home(uint64_t hash) const {
+        return (size_t) ((hash * 0x9E3779B97F4A7C15) >> 32) & (slots.size() - 1);
+    }
+
+    void Grow() {
+        std::vector<uint64_t> old;
+        old.swap(slots);
+        slots.resize(old.size() * 2);
+        size_t mask = slots.size() - 1;
+        for (uint64_t hash: old) {
+            if (hash == 0) {
+                continue;
+            }
+            size_t slot = Home(hash);
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = hash;
+        }
+    }
+};
+
+#endif // STATESET_H
@@ -0,0 +1,94 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <fstream>
+
+TraceRing::TraceRing(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    records = std::make_unique<std::atomic<uint64_t>[]>(size);
+    mask = size - 1;
+}
+
+size_t TraceRing::Capacity() const {
+    return mask + 1;
+}
+
+uint64_t TraceRing::Count() const {
+    return head.load(std::memory_order_acquire);
+}
+
+std::vector<TraceRing::Record> TraceRing::Snapshot() const {
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > Capacity() ? end - Capacity() : 0;
+    std::vector<uint64_t> packed;
+    packed.reserve(end - begin);
+    for (uint64_t index = begin; index < end; index++) {
+        packed.push_back(records[index & mask].load(std::memory_order_relaxed));
+    }
+
+    // the writer may have gone round meanwhile, and may be writing the next
+    // record: what it overwrote, or is overwriting, is not a consistent copy.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t now = head.load(std::memory_order_relaxed);
+    uint64_t valid = now + 1 > Capacity() ? now + 1 - Capacity() : 0;
+
+    std::vector<Record> out;
+    out.reserve(packed.size());
+    for (uint64_t index = std::max(begin, valid); index < end; index++) {
+        uint64_t record = packed[index - begin];
+        out.push_back({index, (uint16_t) record, (uint16_t) (record >> 16), (uint16_t) (record >> 32),
+                       (uint8_t) (record >> 48), (uint8_t) (record >> 56)});
+    }
+    return out;
+}
+
+bool TraceRing::Save(const std::string &file) const {
+    std::ofstream stream(file, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!stream.is_open()) {
+        return false;
+    }
+    std::vector<Record> snapshot = Snapshot();
+    uint64_t first = snapshot.empty() ? 0 : snapshot.front().index;
+    uint64_t count = snapshot.size();
+    uint32_t header[2]{magic, version};
+    stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(&first), sizeof(first));
+    stream.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    for (const Record &record: snapshot) {
+        uint64_t packed = (uint64_t) record.PC | (uint64_t) record.opcode << 16 | (uint64_t) record.I << 32 |
+                          (uint64_t) record.VX << 48 | (uint64_t) record.VF << 56;
+        stream.write(reinterpret_cast<const char *>(&packed), sizeof(packed));
+    }
+    return stream.good();
+}
+
+bool TraceRing::Load(const std::string &file, std::vector<Record> &out) {
+    std::ifstream stream(file, std::ios::binary | std::ios::in);
+    if (!stream.is_open()) {
+        return false;
+    }
+    uint32_t fileMagic = 0;
+    uint32_t fileVersion = 0;
+    uint64_t first = 0;
+    uint64_t count = 0;
+    stream.read(reinterpret_cast<char *>(&fileMagic), sizeof(fileMagic));
+    stream.read(reinterpret_cast<char *>(&fileVersion), sizeof(fileVersion));
+    stream.read(reinterpret_cast<char *>(&first), sizeof(first));
+    stream.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!stream || fileMagic != magic || fileVersion != version) {
+        return false;
+    }
+    out.clear();
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t record;
+        if (!stream.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+            return false;
+        }
+        out.push_back({first + i, (uint16_t) record, (uint16_t) (record >> 16), (uint16_t) (record >> 32),
+                       (uint8_t) (record >> 48), (uint8_t) (record >> 56)});
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// the last instructions executed, in a ring of packed 8-byte records.
+//
+// a record is written after its instruction: PC and opcode, with I, Vx (the
+// register named by the X field) and VF as they are after it. the emulation
+// thread writes, any thread may take a Snapshot at the same time; records
+// overwritten while it copies them are left out.
+//
+// file format, native endianness: magic, version, index of the first record
+// and number of records, then the records.
+class TraceRing {
+public:
+    const static uint32_t magic{0x52543843}; // "C8TR"
+    const static uint32_t version{1};
+
+    struct Record {
+        // index of the record since tracing started.
+        uint64_t index;
+        uint16_t PC;
+        uint16_t opcode;
+        uint16_t I;
+        uint8_t VX;
+        uint8_t VF;
+    };
+
+    // capacity is rounded up to a power of two.
+    explicit TraceRing(size_t capacity);
+
+    void Add(uint16_t pc, uint16_t opcode, uint16_t I, uint8_t VX, uint8_t VF) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        uint64_t packed = (uint64_t) pc | (uint64_t) opcode << 16 | (uint64_t) I << 32 |
+                          (uint64_t) VX << 48 | (uint64_t) VF << 56;
+        records[index & mask].store(packed, std::memory_order_relaxed);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    size_t Capacity() const;
+
+    // records written since construction.
+    uint64_t Count() const;
+
+    // the records still in the ring, oldest first.
+    std::vector<Record> Snapshot() const;
+
+    bool Save(const std::string &file) const;
+
+    // records of a file written by Save, oldest first.
+    static bool Load(const std::string &file, std::vector<Record> &out);
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> records;
+    uint64_t mask;
+    std::atomic<uint64_t> head{0};
+};
+
+#endif // TRACE_H
@@ -0,0 +1,35 @@
+// chip8-trace: decode a trace saved from the trace ring into a disassembly.
+//
+// usage: chip8-trace <trace file>
+//
+// one line per executed instruction, oldest first: its index since tracing
+// started, address, opcode and assembly, then I, Vx and VF after it.
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "decoder.h"
+#include "trace.h"
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: chip8-trace <trace file>" << std::endl;
+        return 1;
+    }
+    std::vector<TraceRing::Record> records;
+    if (!TraceRing::Load(argv[1], records)) {
+        std::cout << "fail to load trace: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    char text[32];
+    for (const TraceRing::Record &record: records) {
+        Disassemble(record.opcode, text, sizeof(text));
+        std::printf("%10llu  %03X  %04X  %-18s I=%03X V%X=%02X VF=%02X\n",
+                    (unsigned long long) record.index, record.PC, record.opcode, text,
+                    record.I, (record.opcode >> 8) & 0x0F, record.VX, record.VF);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// lock-free single producer, single consumer handoff of the latest value.
+//
+// the producer writes Back and publishes it, the consumer takes the latest
+// published value into Front. neither side ever waits; a value published
+// before the consumer took the previous one replaces it and counts as dropped.
+template<typename T>
+class TripleBuffer {
+public:
+    // producer side: the value to publish next.
+    T &Back() {
+        return buffers[back];
+    }
+
+    // producer side: make Back the latest value.
+    // returns false when the previous value was still unconsumed, the consumer
+    // has then already been told about a pending value.
+    bool Publish() {
+        uint8_t old = middle.exchange(back | fresh, std::memory_order_acq_rel);
+        back = old & indexMask;
+        produced.fetch_add(1, std::memory_order_relaxed);
+        if (old & fresh) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // consumer side: take the latest value into Front, false when there is none.
+    bool Consume() {
+        if (!(middle.load(std::memory_order_relaxed) & fresh)) {
+            return false;
+        }
+        uint8_t old = middle.exchange(front, std::memory_order_acq_rel);
+        front = old & indexMask;
+        presented.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // consumer side: the last consumed value.
+    const T &Front() const {
+        return buffers[front];
+    }
+
+    uint64_t Produced() const {
+        return produced.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Presented() const {
+        return presented.load(std::memory_order_relaxed);
+    }
+
+    uint64_t Dropped() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    const static uint8_t indexMask{0x03};
+    const static uint8_t fresh{0x04};
+
+    std::array<T, 3> buffers{};
+    uint8_t back{0};
+    // index of the shared buffer, with fresh set while it holds an unconsumed value.
+    std::atomic<uint8_t> middle{1};
+    uint8_t front{2};
+
+    std::atomic<uint64_t> produced{0};
+    std::atomic<uint64_t> presented{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+#endif // TRIPLEBUFFER_H
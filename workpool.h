@@ -0,0 +1,103 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// runs a fixed set of items on a number of threads, each with its own deque.
+//
+// items are dealt round-robin. a worker takes its own items in the given
+// order from the back of its deque and, once it is empty, steals from the
+// front of the others: their last items, the smallest ones when the order
+// is longest first. uneven items still keep every thread busy until the
+// end. no item is added while running, a worker finding every deque empty
+// is done.
+class WorkPool {
+public:
+    // 0 threads: one per hardware thread.
+    explicit WorkPool(unsigned threads = 0) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        queues.resize(threads == 0 ? 1 : threads);
+        for (auto &queue: queues) {
+            queue = std::make_unique<Queue>();
+        }
+    }
+
+    unsigned Threads() const {
+        return (unsigned) queues.size();
+    }
+
+    // run work(item, worker) for every item and wait for all of them.
+    // worker is the index of the thread, in [0, Threads()).
+    void Run(const std::vector<size_t> &items, const std::function<void(size_t, unsigned)> &work) {
+        for (size_t i = 0; i < items.size(); i++) {
+            queues[i % queues.size()]->items.push_front(items[i]);
+        }
+        std::vector<std::thread> threads;
+        for (unsigned worker = 1; worker < queues.size(); worker++) {
+            threads.emplace_back(&WorkPool::Work, this, worker, std::cref(work));
+        }
+        Work(0, work);
+        for (std::thread &thread: threads) {
+            thread.join();
+        }
+    }
+
+    // items taken from another thread's deque in all runs.
+    size_t Steals() const {
+        size_t steals = 0;
+        for (const auto &queue: queues) {
+            steals += queue->steals;
+        }
+        return steals;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> items;
+        // written only by the owner.
+        size_t steals{0};
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+
+    bool Take(unsigned worker, size_t &item) {
+        Queue &own = *queues[worker];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.items.empty()) {
+                item = own.items.back();
+                own.items.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            Queue &victim = *queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.items.empty()) {
+                item = victim.items.front();
+                victim.items.pop_front();
+                own.steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Work(unsigned worker, const std::function<void(size_t, unsigned)> &work) {
+        size_t item;
+        while (Take(worker, item)) {
+            work(item, worker);
+        }
+    }
+};
+
+#endif // WORKPOOL_H